@@ -0,0 +1,107 @@
+//
+//   AsyncRead.cpp
+//
+//   Console-mode app that runs several independent online analyses as C++20
+//   coroutines on one reader thread, using PlexonAsync.h: a per-unit spike
+//   counter, a strobed-event printer and a continuous-data block counter.
+//   All three share the one read buffer of the PL_AsyncClient.
+//
+//   Usage: AsyncRead [seconds]
+//
+//   Must include Plexon.h and PlexonAsync.h and link with the Linux libPlexClient.so.
+//
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "../../include/Plexon.h"
+#include "../../include/PlexonAsync.h"
+
+
+//** counts sorted spikes per unit on the first four DSP channels
+static PL_AsyncTask CountSpikes(PL_AsyncClient& client)
+{
+  int Counts[5][5] = {};
+  PL_EventFilter Filter;
+  Filter.TypeMask = 1 << PL_SingleWFType;
+  Filter.FirstChannel = 1;
+  Filter.LastChannel = 4;
+  Filter.UnitMask = 0x1e; //** units 1..4, unsorted spikes (unit 0) are ignored
+
+  while (PL_AsyncBatch Batch = co_await client.NextBatch(Filter))
+  {
+    for (const PL_WaveLong& Spike : Batch)
+      Counts[Spike.Channel][Spike.Unit]++;
+  }
+
+  for (int ch = 1; ch <= 4; ch++)
+    printf("SPK%02d: a=%d b=%d c=%d d=%d\r\n", ch, Counts[ch][1], Counts[ch][2], Counts[ch][3], Counts[ch][4]);
+}
+
+
+//** prints every strobed event
+static PL_AsyncTask PrintStrobes(PL_AsyncClient& client)
+{
+  PL_EventFilter Filter;
+  Filter.TypeMask = 1 << PL_ExtEventType;
+  Filter.FirstChannel = Filter.LastChannel = PL_StrobedExtChannel;
+
+  while (PL_AsyncBatch Batch = co_await client.NextBatch(Filter))
+  {
+    for (const PL_WaveLong& Event : Batch)
+      printf("strobed event %d at t=%u\r\n", Event.Unit, Event.TimeStamp);
+  }
+}
+
+
+//** counts blocks and samples of continuous data
+static PL_AsyncTask CountContinuous(PL_AsyncClient& client)
+{
+  long Blocks = 0, Samples = 0;
+  PL_EventFilter Filter;
+  Filter.TypeMask = 1 << PL_ADDataType;
+
+  while (PL_AsyncBatch Batch = co_await client.NextBatch(Filter))
+  {
+    Blocks += Batch.Size();
+    for (const PL_WaveLong& Block : Batch)
+      Samples += Block.NumberOfDataWords;
+  }
+  printf("%ld continuous blocks, %ld samples\r\n", Blocks, Samples);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int Seconds = argc > 1 ? atoi(argv[1]) : 5;
+
+  //** connect to the server
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+
+  {
+    PL_AsyncClient Client;
+
+    //** each task runs until its first co_await, then waits for the reader
+    CountSpikes(Client);
+    PrintStrobes(Client);
+    CountContinuous(Client);
+
+    //** stop reading after the given time; the tasks then see a closed batch
+    std::thread Timer([&Client, Seconds] {
+      std::this_thread::sleep_for(std::chrono::seconds(Seconds));
+      Client.Stop();
+    });
+
+    Client.Run();
+    Timer.join();
+  }
+
+  PL_CloseClient();
+  return 0;
+}
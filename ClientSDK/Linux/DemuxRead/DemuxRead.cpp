@@ -0,0 +1,128 @@
+//
+//   DemuxRead.cpp
+//
+//   Console-mode app that processes each DSP channel on its own worker thread.
+//   The main thread reads the Server and splits every read by channel with
+//   PL_Demux; each worker pulls the spikes of its channel and the continuous
+//   blocks of the matching NIDAQ channel from its own lock-free queue and
+//   keeps a spike count and the mean of the continuous samples.  Prints the
+//   per-channel results when done.
+//
+//   Usage: DemuxRead [channels] [seconds]
+//
+//   Must include Plexon.h, PlexonShm.h and PlexonDemux.h and link with the
+//   Linux libPlexClient.so.
+//
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+#include "../../include/PlexonDemux.h"
+
+
+//** results of one worker
+struct ChannelStats
+{
+  long      Spikes = 0;
+  long      Samples = 0;
+  double    SampleSum = 0;
+};
+
+
+static std::atomic<bool> g_Stop;
+
+
+static void Worker(PL_RecordQueue* Queue, ChannelStats* Stats)
+{
+  PL_WaveLong Records[256];
+  for (;;)
+  {
+    //** check for stop before popping, so the last records are not missed
+    bool Stopping = g_Stop.load();
+    size_t n = Queue->Pop(Records, 256);
+    for (size_t i = 0; i < n; i++)
+    {
+      if (Records[i].Type == PL_SingleWFType)
+        Stats->Spikes++;
+      else
+        for (int s = 0; s < Records[i].NumberOfDataWords; s++, Stats->Samples++)
+          Stats->SampleSum += Records[i].WaveForm[s];
+    }
+    if (n == 0)
+    {
+      if (Stopping)
+        break;
+      timespec Pause = { 0, 200000 };
+      nanosleep(&Pause, NULL);
+    }
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  int Channels = argc > 1 ? atoi(argv[1]) : 4;
+  int Seconds = argc > 2 ? atoi(argv[2]) : 5;
+
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+
+  //** one queue per DSP channel, fed with its spikes and the continuous data of
+  //** the NIDAQ channel with the same index (DSP channels start at 1, NIDAQ at 0)
+  PL_Demux Demux;
+  for (int ch = 1; ch <= Channels; ch++)
+  {
+    int Queue = Demux.AddQueue(1 << 14);
+    Demux.Route(PL_SingleWFType, ch, Queue);
+    Demux.Route(PL_ADDataType, ch - 1, Queue);
+  }
+
+  std::vector<ChannelStats> Stats(Channels);
+  std::vector<std::thread> Workers;
+  for (int q = 0; q < Channels; q++)
+    Workers.emplace_back(Worker, &Demux.Queue(q), &Stats[q]);
+
+  //** read straight from the shared ring into the queues
+  timespec Start, Now;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  long Routed = 0;
+  do
+  {
+    if (PL_WaitForData(1, 100000) < 0)
+    {
+      printf("server closed the connection\r\n");
+      break;
+    }
+    PL_Batch Batch;
+    if (PL_AcquireBatch(65536, &Batch) > 0)
+    {
+      Routed += Demux.Demux(Batch);
+      if (!PL_ReleaseBatch(Batch.NumRecords))
+        printf("the server overwrote records while they were being routed\r\n");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+  } while (Now.tv_sec - Start.tv_sec < Seconds);
+
+  g_Stop = true;
+  for (std::thread& Thread : Workers)
+    Thread.join();
+
+  printf("%ld records routed\r\n", Routed);
+  for (int q = 0; q < Channels; q++)
+    printf("SPK%d: %ld spikes, AD%02d: %ld samples, mean %.1f, %llu dropped\r\n", q + 1, Stats[q].Spikes,
+      q, Stats[q].Samples, Stats[q].Samples ? Stats[q].SampleSum/Stats[q].Samples : 0.0,
+      Demux.Queue(q).Dropped());
+
+  PL_CloseClient();
+  return 0;
+}
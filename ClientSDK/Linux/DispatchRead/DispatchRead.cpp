@@ -0,0 +1,95 @@
+//
+//   DispatchRead.cpp
+//
+//   Console-mode app that lets the client library read the Server on its own
+//   thread and dispatch the records to handlers, instead of a read loop with a
+//   switch on Type as in the MFCEventWait sample.  Counts the sorted spikes of
+//   each unit of the first four DSP channels and all other spikes, prints
+//   strobed events as they arrive and counts the continuous sample blocks.
+//   Prints the counts once per second.
+//
+//   Usage: DispatchRead [seconds]
+//
+//   Must include Plexon.h and PlexonShm.h and link with the Linux libPlexClient.so.
+//
+
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+
+//** counters updated by the handlers on the dispatch thread
+static std::atomic<long> g_UnitSpikes[5][5];   //** [channel][unit] for channels 1 to 4, units 1 to 4
+static std::atomic<long> g_OtherSpikes;
+static std::atomic<long> g_SlowBlocks;
+
+
+static void OnSortedSpikes(const PL_WaveLong* const* records, int count, void* context)
+{
+  (void)context;
+  for (int i = 0; i < count; i++)
+    g_UnitSpikes[records[i]->Channel][records[i]->Unit]++;
+}
+
+
+static void OnOtherSpikes(const PL_WaveLong* const* records, int count, void* context)
+{
+  (void)records; (void)context;
+  g_OtherSpikes += count;
+}
+
+
+static void OnStrobedEvents(const PL_WaveLong* const* records, int count, void* context)
+{
+  int MAPSampleRate = *(int*)context;
+  for (int i = 0; i < count; i++)
+    printf("strobed event %d t=%f\r\n", records[i]->Unit, (float)records[i]->TimeStamp/(float)MAPSampleRate);
+}
+
+
+static void OnSlowBlocks(const PL_WaveLong* const* records, int count, void* context)
+{
+  (void)records; (void)context;
+  g_SlowBlocks += count;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int Seconds = argc > 1 ? atoi(argv[1]) : 0;
+
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+  int MAPSampleRate = 1000000/PL_GetTimeStampTick();
+
+  //** the handler registered last wins, so the general ones go first
+  PL_AddHandler(PL_SingleWFType, PL_DISPATCH_ANY, PL_DISPATCH_ANY, OnOtherSpikes, NULL);
+  for (int ch = 1; ch <= 4; ch++)
+    for (int unit = 1; unit <= 4; unit++)
+      PL_AddHandler(PL_SingleWFType, ch, unit, OnSortedSpikes, NULL);
+  PL_AddHandler(PL_ExtEventType, PL_StrobedExtChannel, PL_DISPATCH_ANY, OnStrobedEvents, &MAPSampleRate);
+  PL_AddHandler(PL_ADDataType, PL_DISPATCH_ANY, PL_DISPATCH_ANY, OnSlowBlocks, NULL);
+
+  PL_StartDispatch(0);
+  for (int t = 1; Seconds == 0 || t <= Seconds; t++)
+  {
+    sleep(1);
+    printf("t=%ds:", t);
+    for (int ch = 1; ch <= 4; ch++)
+      printf(" SPK%d %ld/%ld/%ld/%ld", ch, g_UnitSpikes[ch][1].load(), g_UnitSpikes[ch][2].load(),
+        g_UnitSpikes[ch][3].load(), g_UnitSpikes[ch][4].load());
+    printf(", other spikes %ld, continuous blocks %ld\r\n", g_OtherSpikes.load(), g_SlowBlocks.load());
+  }
+
+  PL_StopDispatch();
+  PL_CloseClient();
+  return 0;
+}
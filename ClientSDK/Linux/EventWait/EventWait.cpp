@@ -0,0 +1,176 @@
+//
+//   EventWait.cpp
+//
+//   Linux version of the EventWait sample: a console-mode app that reads spike
+//   timestamps and NIDAQ samples from the Server and prints the individual
+//   timestamps and samples to the console.  Instead of waiting on the Windows
+//   "PlexonServerEvent", it calls PL_WaitForData, which wakes the client as soon
+//   as the requested number of records has been published.
+//
+//   Usage: EventWait [minEvents] [maxWaitMicros]
+//
+//   Must include Plexon.h and PlexonShm.h and link with the Linux libPlexClient.so.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+//** maximum number of MAP events to be read at one time from the Server
+#define MAX_MAP_EVENTS_PER_READ 500000
+
+
+//** seconds since an arbitrary point, for printing
+static double Now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
+int main(int argc, char* argv[])
+{
+  PL_WaveLong*  pServerEventBuffer;     //** buffer in which the Server will return MAP events
+  int           NumMAPEvents;           //** number of MAP events returned from the Server
+  int           NumNIDAQSamples;        //** number of samples within a NIDAQ sample block
+  int           NumSpikeTimestamps;     //** number of spike timestamps in one read from server
+  int           SpikeChannel;           //** DSP channel on which a spike timestamp occurred
+  char          SpikeUnit;              //** a,b,c or d
+  unsigned      SpikeTime;              //** spike timestamp
+  unsigned      SampleTime;             //** timestamp a NIDAQ sample
+  int           MAPSampleRate;          //** samples/sec for MAP channels
+  int           NIDAQSampleRate;        //** samples/sec for NIDAQ channels
+  int           ServerDropped;          //** nonzero if server dropped any data
+  int           MMFDropped;             //** nonzero if MMF dropped any data
+  int           PollHigh;               //** high 32 bits of polling time
+  int           PollLow;                //** low 32 bits of polling time
+  int           MAPEventIndex;          //** loop counter
+  int           SampleIndex;            //** loop counter
+  int           MinEvents = 1;          //** number of records to wait for
+  int           MaxWaitMicros = 10000000; //** give up waiting after 10 seconds
+  int           Dummy[64];
+
+  if (argc > 1)
+    MinEvents = atoi(argv[1]);
+  if (argc > 2)
+    MaxWaitMicros = atoi(argv[2]);
+
+  //** connect to the server
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+
+  //** allocate memory in which the server will return MAP events
+  pServerEventBuffer = (PL_WaveLong*)malloc(sizeof(PL_WaveLong)*MAX_MAP_EVENTS_PER_READ);
+  if (pServerEventBuffer == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    PL_CloseClient();
+    return 1;
+  }
+
+  //** get the MAP sampling rate (spike timestamps); PL_GetTimeStampTick returns
+  //** the timestamp resolution in microseconds
+  MAPSampleRate = 1000000/PL_GetTimeStampTick();
+
+  //** get the NIDAQ sampling rate
+  PL_GetSlowInfo(&NIDAQSampleRate, Dummy, Dummy); //** last two params are unused here
+
+  //** this loop waits until at least MinEvents MAP events are ready, then reads
+  //** them from the Server, until the user hits Control-C or the wait times out
+  for (unsigned count = 0; ; count++)
+  {
+    int pending = PL_WaitForData(MinEvents, MaxWaitMicros);
+    if (pending < 0)
+    {
+      printf("server closed the connection\r\n");
+      break;
+    }
+    if (pending < MinEvents)
+    {
+      printf("PL_WaitForData timed out (%d usecs)\r\n", MaxWaitMicros);
+      break;
+    }
+
+    //** this tells the Server the max number of MAP events that can be returned to us in one read
+    NumMAPEvents = MAX_MAP_EVENTS_PER_READ;
+
+    //** call the Server to get all the MAP events since the last time we called PL_GetLongWaveFormStructuresEx2
+    PL_GetLongWaveFormStructuresEx2(&NumMAPEvents, pServerEventBuffer,
+      &ServerDropped, &MMFDropped, &PollHigh, &PollLow);
+
+    //** latency of the newest record: from its acquisition, per the clock model, to now
+    double Latency = 0;
+    if (NumMAPEvents > 0)
+    {
+      const PL_WaveLong& Last = pServerEventBuffer[NumMAPEvents - 1];
+      unsigned long long Acquired = PL_MapTimeToHost(((unsigned long long)Last.UpperTS << 32) | Last.TimeStamp);
+      if (Acquired)
+        Latency = ((double)PL_GetHostTime() - (double)Acquired)*1e-6;
+    }
+
+    printf("[%u] t = %.6f, %u blocks, latency %.3f ms\n", count, Now(), NumMAPEvents, Latency);
+
+    //** step through the array of MAP events, displaying the sorted spikes and the NIDAQ samples
+    //** of the first NIDAQ channel
+    //** note: any number of spike timestamps and blocks of NIDAQ samples may occur in any order
+    NumSpikeTimestamps = 0;
+    for (MAPEventIndex = 0; MAPEventIndex < NumMAPEvents; MAPEventIndex++)
+    {
+      //** is this MAP event the timestamp of a sorted spike? (unsorted spikes have Unit == 0)
+      if (pServerEventBuffer[MAPEventIndex].Type == PL_SingleWFType &&
+          pServerEventBuffer[MAPEventIndex].Unit >= 1 &&
+          pServerEventBuffer[MAPEventIndex].Unit <= 4)
+      {
+        SpikeChannel = pServerEventBuffer[MAPEventIndex].Channel; //** DSP channel number 1,2,3...
+        SpikeUnit = 'a' + (pServerEventBuffer[MAPEventIndex].Unit-1); //** unit 1,2,3,4 = a,b,c,d
+        SpikeTime = pServerEventBuffer[MAPEventIndex].TimeStamp;
+        printf("SPK%d%c t=%f\r\n", SpikeChannel, SpikeUnit, (float)SpikeTime/(float)MAPSampleRate);
+        NumSpikeTimestamps++;
+      }
+
+      //** is this MAP event a block of NIDAQ samples from the first NIDAQ channel?
+      else if (pServerEventBuffer[MAPEventIndex].Type == PL_ADDataType &&
+          pServerEventBuffer[MAPEventIndex].Channel == 0)
+      {
+        NumNIDAQSamples = pServerEventBuffer[MAPEventIndex].NumberOfDataWords;
+        SampleTime = pServerEventBuffer[MAPEventIndex].TimeStamp;
+        printf("%d samples:\r\n", NumNIDAQSamples);
+        for (SampleIndex = 0; SampleIndex < NumNIDAQSamples; SampleIndex++)
+        {
+          //** note: the ratio MAPSampleRate/NIDAQSampleRate is always an integer
+          if (SampleIndex > 0)
+            SampleTime += MAPSampleRate/NIDAQSampleRate;
+          printf("value=%d t=%f\r\n",
+            pServerEventBuffer[MAPEventIndex].WaveForm[SampleIndex], (float)SampleTime/(float)MAPSampleRate);
+        }
+      }
+    }
+
+    if (!NumSpikeTimestamps)
+      printf("no spikes\r\n");
+  }
+
+  //** latency percentiles over the whole run, as kept by the client library
+  static const char* LatencyNames[PL_LATENCY_COUNT] = { "oldest", "newest", "publish", "copy", "wakeup" };
+  for (int which = 0; which < PL_LATENCY_COUNT; which++)
+  {
+    PL_LatencyStats Stats;
+    PL_GetLatencyStats(which, &Stats);
+    printf("%-8s n=%llu min %.3f p50 %.3f p99 %.3f p99.9 %.3f max %.3f ms\r\n", LatencyNames[which],
+      Stats.Count, Stats.MinNanos*1e-6, Stats.P50Nanos*1e-6, Stats.P99Nanos*1e-6,
+      Stats.P999Nanos*1e-6, Stats.MaxNanos*1e-6);
+  }
+
+  free(pServerEventBuffer);
+  PL_CloseClient();
+
+  return 0;
+}
@@ -0,0 +1,134 @@
+//
+//   LatencyBench.cpp
+//
+//   Console-mode app that measures how quickly a client sees the data the
+//   Server publishes, first with the usual blocking PL_WaitForData and then
+//   with the busy-poll mode of PL_InitClientEx4, and prints the two side by
+//   side: the time from each publish to the end of the read that returned it
+//   (PL_LATENCY_PUBLISH) and the share of the time the client spent waiting.
+//
+//   Usage: LatencyBench [-t seconds] [-c cpu] [-r priority] [-m]
+//            -t  length of each run (default 5 seconds)
+//            -c  pin the busy-poll run to this core
+//            -r  run the busy-poll run under SCHED_FIFO at this priority
+//            -m  lock the busy-poll run's memory in RAM
+//
+//   The busy-poll run keeps one core busy; with -r it must have a core of its
+//   own (-c), or it starves the Server and everything else on that core.
+//
+//   Must include Plexon.h and PlexonShm.h and link with the Linux libPlexClient.so.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+//** maximum number of MAP events to be read at one time from the Server
+#define MAX_MAP_EVENTS_PER_READ 500000
+
+
+struct RunResult
+{
+  PL_LatencyStats   Latency;
+  PL_SpinStats      Spin;
+  long              Reads;
+};
+
+
+//** connects with the given options and reads for Seconds seconds
+static bool Run(const PL_ClientOptions* Options, int Seconds, PL_WaveLong* Buffer, RunResult* Result)
+{
+  if (!PL_InitClientEx4(0, Options))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return false;
+  }
+
+  //** start from the next publish, with clean statistics
+  PL_SkipToLatest();
+  PL_ResetLatencyStats();
+  PL_ResetSpinStats();
+
+  timespec Start, Now;
+  clock_gettime(CLOCK_MONOTONIC, &Start);
+  Result->Reads = 0;
+  do
+  {
+    if (PL_WaitForData(1, 1000000) < 0)
+      break;
+    int NumMAPEvents = MAX_MAP_EVENTS_PER_READ;
+    int ServerDropped, MMFDropped, PollHigh, PollLow;
+    PL_GetLongWaveFormStructuresEx2(&NumMAPEvents, Buffer, &ServerDropped, &MMFDropped, &PollHigh, &PollLow);
+    Result->Reads++;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+  } while (Now.tv_sec - Start.tv_sec < Seconds);
+
+  PL_GetLatencyStats(PL_LATENCY_PUBLISH, &Result->Latency);
+  PL_GetSpinStats(&Result->Spin);
+  PL_CloseClient();
+  return true;
+}
+
+
+static void Print(const char* Name, const RunResult& Result)
+{
+  const PL_LatencyStats& L = Result.Latency;
+  const PL_SpinStats& S = Result.Spin;
+  double Total = (double)(S.WaitNanos + S.WorkNanos);
+  printf("%-9s %7ld %8.1f %8.1f %8.1f %8.1f %8.1f %7.1f%% %5s %4s %3s\r\n", Name, Result.Reads,
+    L.MinNanos*1e-3, L.P50Nanos*1e-3, L.P99Nanos*1e-3, L.P999Nanos*1e-3, L.MaxNanos*1e-3,
+    Total > 0 ? 100.0*S.WaitNanos/Total : 0.0,
+    (S.Applied & PL_CLIENT_PIN_CPU) ? "yes" : "no", (S.Applied & PL_CLIENT_REALTIME) ? "yes" : "no",
+    (S.Applied & PL_CLIENT_LOCK_MEMORY) ? "yes" : "no");
+}
+
+
+int main(int argc, char* argv[])
+{
+  int Seconds = 5;
+  PL_ClientOptions Busy = { sizeof(PL_ClientOptions), PL_CLIENT_BUSY_POLL, 0, 0, 0 };
+
+  int opt;
+  while ((opt = getopt(argc, argv, "t:c:r:m")) != -1)
+  {
+    switch (opt)
+    {
+    case 't': Seconds = atoi(optarg); break;
+    case 'c': Busy.Flags |= PL_CLIENT_PIN_CPU; Busy.Cpu = atoi(optarg); break;
+    case 'r': Busy.Flags |= PL_CLIENT_REALTIME; Busy.Priority = atoi(optarg); break;
+    case 'm': Busy.Flags |= PL_CLIENT_LOCK_MEMORY; break;
+    default:
+      printf("usage: %s [-t seconds] [-c cpu] [-r priority] [-m]\r\n", argv[0]);
+      return 1;
+    }
+  }
+
+  PL_WaveLong* Buffer = (PL_WaveLong*)malloc(sizeof(PL_WaveLong)*MAX_MAP_EVENTS_PER_READ);
+  if (Buffer == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    return 1;
+  }
+
+  RunResult Blocking, Polling;
+  printf("blocking run, %d seconds...\r\n", Seconds);
+  if (!Run(NULL, Seconds, Buffer, &Blocking))
+    return 1;
+  printf("busy-poll run, %d seconds...\r\n", Seconds);
+  if (!Run(&Busy, Seconds, Buffer, &Polling))
+    return 1;
+
+  printf("publish-to-read latency in microseconds\r\n");
+  printf("%-9s %7s %8s %8s %8s %8s %8s %8s %5s %4s %3s\r\n", "mode", "reads", "min", "p50", "p99",
+    "p99.9", "max", "waiting", "pin", "fifo", "mem");
+  Print("blocking", Blocking);
+  Print("busy-poll", Polling);
+
+  free(Buffer);
+  return 0;
+}
@@ -0,0 +1,2042 @@
+//
+//   PlexClient.cpp
+//
+//   Linux implementation of the Plexon.h client API on top of the POSIX
+//   shared-memory ring created by a server process (see PlexServer.h and
+//   PlexShm.h).  All clients read the same ring, each through its own cursor
+//   slot in the segment header; every PL_Get* call copies the records
+//   published since the previous call, exactly like the MMF-based
+//   PlexClient.dll.
+//
+
+#include "PlexShm.h"
+#include "PlexHistogram.h"
+#include "../../include/PlexonShm.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <type_traits>
+#include <unistd.h>
+
+
+//
+// state of the client connection in this process
+//
+struct CLane
+{
+    PL_WaveLong*    Records;
+    uint64_t        Mask;
+    uint64_t*       Shadow;             // shadow ring of the lane
+    uint64_t        ShadowMask;
+};
+
+//
+// decimation state of a client, see PL_SetDecimation
+//
+struct CEnvelope
+{
+    uint64_t        Group;              // group of ContinuousFactor sample times + 1 being accumulated, 0 if none
+    uint64_t        Emitted;            // last group + 1 whose pair was delivered
+    uint64_t        TimeStamp;          // of the group's first sample
+    short           Min;
+    short           Max;
+};
+
+struct CDecimator
+{
+    PL_Decimation   Settings;
+    uint64_t        TickRate;           // timestamp ticks per second
+    uint32_t        SampleRate[PL_SUB_MAX_CHANNEL];     // continuous samples per second, 0 if unknown
+    uint64_t        LastSlot[PL_SUB_MAX_CHANNEL][32];   // slot + 1 of the last waveform kept per unit
+    CEnvelope       Envelope[PL_SUB_MAX_CHANNEL];
+    PL_WaveLong     Out;                // record delivered in place of a thinned one
+};
+
+// state changed by one Decimate call, to take back if the record is not delivered
+struct CDecimateUndo
+{
+    uint64_t*       Slot;               // NULL if unchanged
+    uint64_t        SlotValue;
+    CEnvelope*      Envelope;           // NULL if unchanged
+    CEnvelope       EnvelopeValue;
+};
+
+struct CClient
+{
+    size_t          Size;
+    PL_ShmHeader*   Header;
+    CLane           Lanes[PL_SHM_LANES];
+    int             NumLanes;           // 2 if the server has a continuous lane
+    unsigned        Selected;           // bit (1 << lane) for each lane read, see PL_SelectLanes
+    PL_ShmCursor*   Cursor;             // this client's read position in the segment
+    int             BatchLane;          // lane of the batch borrowed by PL_AcquireBatch
+    uint64_t        BatchStart;         // first record of the batch
+    uint64_t        BatchCount;         // number of records borrowed, 0 if none
+    bool            Filtered;           // Subscription applies
+    CDecimator*     Decimator;          // set by PL_SetDecimation, NULL if none
+    PL_Subscription Subscription;       // set by PL_SetSubscription
+    uint64_t        ClockCount;         // clock samples seen by the last fit
+    PL_ClockModel   Clock;              // valid if ClockCount > 0
+    uint64_t        LastReadStart;      // PL_ShmNow() at the start of the previous read, 0 if none
+    CHistogram      Latency[PL_LATENCY_COUNT];
+    uint64_t        MMFDrops[PL_SUB_MAX_TYPE + 1][PL_SUB_MAX_CHANNEL];
+    uint64_t        MMFDropTimeStamp[PL_SUB_MAX_TYPE + 1][PL_SUB_MAX_CHANNEL];
+    uint64_t        MMFDropsUnattributed;
+    uint64_t        ServerDropsBase[PL_SUB_MAX_TYPE + 1][PL_SUB_MAX_CHANNEL];   // server counters at the last reset
+    uint64_t        ServerDroppedBase;
+    uint64_t        ServerDroppedAttributedBase;
+    PL_ClientOptions Options;           // passed to PL_InitClientEx4
+    std::atomic<bool> ThreadSetUp;      // pinning and scheduling applied to the waiting thread
+    PL_SpinStats    Spin;
+    uint64_t        LastWaitEnd;        // PL_ShmNow() at the end of the previous wait, 0 if none
+    PL_SequenceGap  Gaps[PL_SEQUENCE_MAX_GAPS]; // gap i in Gaps[i % PL_SEQUENCE_MAX_GAPS]
+    uint64_t        GapCount;           // gaps so far
+    uint64_t        GapsTaken;          // gaps returned by PL_GetSequenceGaps
+    bool            Replaying;          // replayed records are left to read
+    bool            Replayed;           // connected with PL_CLIENT_REPLAY
+    uint64_t        ReplayEnd[PL_SHM_LANES];    // first record of each lane not replayed
+};
+
+static CClient* g_Client = NULL;
+
+
+static inline uint64_t GetReadIndex(int lane)
+{
+    return g_Client->Cursor->ReadIndex[lane].load(std::memory_order_relaxed);
+}
+
+
+// moves the cursor of a lane; lost records are counted against this client
+static inline void SetReadIndex(int lane, uint64_t r, uint64_t lost)
+{
+    if (lost)
+        g_Client->Cursor->MMFDropped.fetch_add(lost, std::memory_order_relaxed);
+    g_Client->Cursor->ReadIndex[lane].store(r, std::memory_order_release);
+}
+
+
+// index of the oldest record of a lane that the server is not overwriting
+static inline uint64_t OldestIntact(int lane, std::memory_order order)
+{
+    uint64_t capacity = g_Client->Lanes[lane].Mask + 1;
+    uint64_t claim = g_Client->Header->Lanes[lane].WriteClaim.load(order);
+    return claim > capacity ? claim - capacity : 0;
+}
+
+
+static inline bool IsSelected(int lane)
+{
+    return (g_Client->Selected >> lane) & 1;
+}
+
+
+// sequence number of record i of a lane
+static inline uint64_t Sequence(int lane, uint64_t i)
+{
+    return lane == PL_SHM_LANE_CONTINUOUS ? i | PL_SEQUENCE_CONTINUOUS : i;
+}
+
+
+// first index in [lo, hi) of a lane whose record is later than ts, hi if none
+static uint64_t FirstAfter(int lane, uint64_t lo, uint64_t hi, uint64_t ts)
+{
+    const CLane& l = g_Client->Lanes[lane];
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo)/2;
+        if (PL_ShmTimeStamp(l.Records[mid & l.Mask]) <= ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+// Reads the write indexes of all lanes as left by one publish (PublishSeq
+// seqlock), so that the lanes can be merged by timestamp.
+static void GetWriteIndexes(uint64_t* w)
+{
+    PL_ShmHeader* hdr = g_Client->Header;
+    for (;;)
+    {
+        uint64_t seq = hdr->PublishSeq.load(std::memory_order_acquire);
+        if (seq & 1)
+            continue; //** the server is between two stores
+        for (int lane = 0; lane < PL_SHM_LANES; lane++)
+            w[lane] = hdr->Lanes[lane].WriteIndex.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (hdr->PublishSeq.load(std::memory_order_relaxed) == seq)
+            return;
+    }
+}
+
+
+// While replayed records are left to read, reads stop at the end of the
+// replay so that none mixes replayed records with new ones.
+static void LimitToReplay(uint64_t* w)
+{
+    if (!g_Client->Replaying)
+        return;
+    bool done = true;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+        done &= !IsSelected(lane) || GetReadIndex(lane) >= g_Client->ReplayEnd[lane];
+    if (done)
+    {
+        g_Client->Replaying = false;
+        return;
+    }
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+        if (w[lane] > g_Client->ReplayEnd[lane])
+            w[lane] = g_Client->ReplayEnd[lane];
+}
+
+
+// records of the selected lanes published but not read yet, at most the
+// capacity of each lane
+static uint64_t Pending(const uint64_t* w, const uint64_t* r)
+{
+    uint64_t pending = 0;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        if (!IsSelected(lane))
+            continue;
+        uint64_t n = w[lane] > r[lane] ? w[lane] - r[lane] : 0;
+        pending += n > g_Client->Lanes[lane].Mask + 1 ? g_Client->Lanes[lane].Mask + 1 : n;
+    }
+    return pending;
+}
+
+
+// Attributes the records [from, to) that the client lost to their type and
+// channel through the shadow ring.  Entries the server overwrites while they
+// are read, or that are gone already, count as unattributed.
+static void AttributeLost(int lane, uint64_t from, uint64_t to)
+{
+    PL_ShmLane& shm = g_Client->Header->Lanes[lane];
+    const CLane& l = g_Client->Lanes[lane];
+    uint64_t shadowCapacity = l.ShadowMask + 1;
+    uint64_t unattributed = 0;
+    uint64_t entries[1024];
+
+    //** the newest records may not have a shadow entry yet if the server lost
+    //** them within a single publish
+    uint64_t w = shm.WriteIndex.load(std::memory_order_acquire);
+    if (to > w)
+    {
+        unattributed += to - (from > w ? from : w);
+        to = from > w ? from : w;
+    }
+
+    while (from < to)
+    {
+        uint64_t claim = shm.WriteClaim.load(std::memory_order_acquire);
+        uint64_t oldest = claim > shadowCapacity ? claim - shadowCapacity : 0;
+        if (from < oldest)
+        {
+            uint64_t gone = (oldest < to ? oldest : to) - from;
+            unattributed += gone;
+            from += gone;
+            continue;
+        }
+        int n = to - from < 1024 ? (int)(to - from) : 1024;
+        for (int i = 0; i < n; i++)
+            entries[i] = l.Shadow[(from + i) & l.ShadowMask];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        claim = shm.WriteClaim.load(std::memory_order_relaxed);
+        oldest = claim > shadowCapacity ? claim - shadowCapacity : 0;
+        for (int i = 0; i < n; i++)
+        {
+            unsigned type = PL_ShmShadowType(entries[i]);
+            unsigned ch = PL_ShmShadowChannel(entries[i]);
+            if (from + i < oldest || type > PL_SUB_MAX_TYPE || ch >= PL_SUB_MAX_CHANNEL)
+            {
+                unattributed++;
+                continue;
+            }
+            g_Client->MMFDrops[type][ch]++;
+            uint64_t ts = PL_ShmShadowTimeStamp(entries[i]);
+            if (ts > g_Client->MMFDropTimeStamp[type][ch])
+                g_Client->MMFDropTimeStamp[type][ch] = ts;
+        }
+        from += n;
+    }
+    g_Client->MMFDropsUnattributed += unattributed;
+}
+
+
+// accounts for the records [from, to) of a lane that the client lost:
+// attributes them and keeps the range for PL_GetSequenceGaps
+static void NoteLost(int lane, uint64_t from, uint64_t to)
+{
+    AttributeLost(lane, from, to);
+    PL_SequenceGap& gap = g_Client->Gaps[g_Client->GapCount++ % PL_SEQUENCE_MAX_GAPS];
+    gap.First = Sequence(lane, from);
+    gap.Count = to - from;
+}
+
+
+// server-side drops since the previous call
+static int TakeServerDropped()
+{
+    if (!g_Client)
+        return 0;
+    uint64_t total = g_Client->Header->ServerDropped.load(std::memory_order_relaxed);
+    uint64_t seen = g_Client->Cursor->ServerDropped.exchange(total, std::memory_order_relaxed);
+    return (int)(total - seen);
+}
+
+
+// Runs read(config) on the configuration snapshot in the segment until it
+// completes without the server changing the snapshot meanwhile (seqlock).
+// Returns false, without calling read, if the client is not connected.
+template <class Reader>
+static bool ReadConfig(Reader read)
+{
+    if (!g_Client)
+        return false;
+    PL_ShmHeader* hdr = g_Client->Header;
+    for (;;)
+    {
+        uint64_t seq = hdr->ConfigSeq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            sched_yield();
+            continue;
+        }
+        read(hdr->Config);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (hdr->ConfigSeq.load(std::memory_order_relaxed) == seq)
+            return true;
+    }
+}
+
+
+// one int of the configuration, 0 if not connected
+template <class Field>
+static int ConfigValue(Field field)
+{
+    int value = 0;
+    ReadConfig([&](const PL_ConfigSnapshot& config) { value = field(config); });
+    return value;
+}
+
+
+// copies a name of the configuration, "" if not connected or out of range
+template <int Count>
+static void CopyConfigName(char* name, char (PL_ConfigSnapshot::*names)[Count][PL_CONFIG_NAME_LENGTH],
+                           int index)
+{
+    if (!name)
+        return;
+    name[0] = 0;
+    if (index < 0 || index >= Count)
+        return;
+    ReadConfig([&](const PL_ConfigSnapshot& config) {
+        memcpy(name, (config.*names)[index], PL_CONFIG_NAME_LENGTH);
+        name[PL_CONFIG_NAME_LENGTH - 1] = 0;
+    });
+}
+
+
+static inline void SplitPollTime(uint64_t pollTime, int* pollhigh, int* polllow)
+{
+    if (pollhigh)
+        *pollhigh = (int)(pollTime >> 32);
+    if (polllow)
+        *polllow = (int)(pollTime & 0xffffffff);
+}
+
+
+// true if the record passes the client's subscription filter
+static inline bool Subscribed(const PL_Subscription& sub, const PL_WaveLong& rec)
+{
+    unsigned type = (unsigned char)rec.Type;
+    unsigned ch = (unsigned short)rec.Channel;
+    if (type > PL_SUB_MAX_TYPE || !(sub.TypeMask & (1u << type)) || ch >= PL_SUB_MAX_CHANNEL ||
+        !(sub.ChannelMask[type][ch >> 5] & (1u << (ch & 31))))
+        return false;
+    if (type == PL_SingleWFType)
+    {
+        unsigned unit = (unsigned short)rec.Unit;
+        return unit < 32 && (sub.UnitMask & (1u << unit));
+    }
+    return true;
+}
+
+
+// Returns the record as the client gets it after decimation: rec itself,
+// d->Out holding a thinned copy of it, or NULL if nothing of it is left.
+// The decisions are made from the timestamps, so that records read twice
+// (after an overrun) are not delivered twice; a read that is dropped after an
+// overrun can cost the waveforms and pairs it took, never duplicate them.
+static const PL_WaveLong* Decimate(CDecimator* d, const PL_WaveLong& rec, CDecimateUndo* undo)
+{
+    undo->Slot = NULL;
+    undo->Envelope = NULL;
+    unsigned ch = (unsigned short)rec.Channel;
+    if (ch >= PL_SUB_MAX_CHANNEL)
+        return &rec;
+    uint64_t ts = PL_ShmTimeStamp(rec);
+
+    //** one waveform per unit and slot of 1/WaveformRate s; the other spikes
+    //** of the slot keep their timestamp only
+    if (rec.Type == PL_SingleWFType)
+    {
+        if (!d->Settings.WaveformRate || rec.NumberOfDataWords <= 0)
+            return &rec;
+        uint64_t slot = ts*(uint64_t)d->Settings.WaveformRate/d->TickRate + 1;
+        uint64_t& last = d->LastSlot[ch][(unsigned short)rec.Unit & 31];
+        if (slot > last)
+        {
+            undo->Slot = &last;
+            undo->SlotValue = last;
+            last = slot;
+            return &rec;
+        }
+        memcpy(&d->Out, &rec, sizeof(PL_Event));
+        d->Out.NumberOfDataWords = 0;
+        return &d->Out;
+    }
+
+    uint64_t factor = (uint64_t)d->Settings.ContinuousFactor;
+    uint64_t freq = d->SampleRate[ch];
+    if (rec.Type != PL_ADDataType || factor <= 1 || freq == 0 || rec.NumberOfDataWords <= 0)
+        return &rec;
+    int n = rec.NumberOfDataWords > MAX_WF_LENGTH_LONG ? MAX_WF_LENGTH_LONG : rec.NumberOfDataWords;
+
+    //** sample i of the grid common to all channels is at round(i*TickRate/freq)
+    //** ticks, so the grid stays exact at rates that do not divide the tick rate
+    uint64_t rate = d->TickRate;
+    uint64_t first = (2*ts*freq + rate)/(2*rate);       //** grid sample of WaveForm[0]
+    auto sampleTs = [&](int k) { return ts + (2*(uint64_t)k*rate + freq)/(2*freq); };
+    uint64_t outTs = 0;
+    int out = 0;
+
+    if (d->Settings.ContinuousMode == PL_DECIMATE_PICK)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            if ((first + k) % factor)
+                continue;
+            if (out == 0)
+                outTs = sampleTs(k);
+            d->Out.WaveForm[out++] = rec.WaveForm[k];
+        }
+    }
+    else
+    {
+        //** a pair per whole group of factor sample times; a group the
+        //** stream skipped part of is dropped, so the pairs of a record are
+        //** always consecutive (and at most n/factor + 1 of them)
+        CEnvelope& e = d->Envelope[ch];
+        undo->Envelope = &e;
+        undo->EnvelopeValue = e;
+        for (int k = 0; k < n; k++)
+        {
+            uint64_t t = first + k;
+            uint64_t group = t/factor + 1;
+            short v = rec.WaveForm[k];
+            if (group <= e.Emitted)
+                continue;
+            if (e.Group != group)
+            {
+                e.Group = 0;
+                if (t % factor)
+                    continue;
+                e.Group = group;
+                e.TimeStamp = sampleTs(k);
+                e.Min = e.Max = v;
+            }
+            else
+            {
+                e.Min = v < e.Min ? v : e.Min;
+                e.Max = v > e.Max ? v : e.Max;
+            }
+            if (t % factor == factor - 1)
+            {
+                if (out == 0)
+                    outTs = e.TimeStamp;
+                d->Out.WaveForm[out++] = e.Min;
+                d->Out.WaveForm[out++] = e.Max;
+                e.Emitted = e.Group;
+                e.Group = 0;
+            }
+        }
+    }
+
+    if (out == 0)
+        return NULL;
+    memcpy(&d->Out, &rec, sizeof(PL_Event));
+    d->Out.UpperTS = (unsigned char)(outTs >> 32);
+    d->Out.TimeStamp = (PL_UINT32)outTs;
+    d->Out.NumberOfDataWords = (char)out;
+    return &d->Out;
+}
+
+
+static void UndoDecimate(const CDecimateUndo& undo)
+{
+    if (undo.Slot)
+        *undo.Slot = undo.SlotValue;
+    if (undo.Envelope)
+        *undo.Envelope = undo.EnvelopeValue;
+}
+
+
+static bool FitClock();
+extern "C" unsigned long long WINAPI PL_MapTimeToHost(unsigned long long ts);
+
+
+// adds one read to the latency histograms: start and end of the read call,
+// publish time of the server and timestamps of the first and last records
+// delivered (count of them)
+static void RecordLatency(uint64_t start, uint64_t end, uint64_t pollTime,
+                          uint64_t firstTs, uint64_t lastTs, int count)
+{
+    CHistogram* hist = g_Client->Latency;
+    if (g_Client->LastReadStart)
+        hist[PL_LATENCY_WAKEUP].Record(start - g_Client->LastReadStart);
+    g_Client->LastReadStart = start;
+    if (count <= 0)
+        return;
+
+    hist[PL_LATENCY_COPY].Record(end - start);
+    hist[PL_LATENCY_PUBLISH].Record(end > pollTime ? end - pollTime : 0);
+    if (FitClock())
+    {
+        uint64_t oldest = PL_MapTimeToHost(firstTs);
+        uint64_t newest = PL_MapTimeToHost(lastTs);
+        hist[PL_LATENCY_OLDEST].Record(end > oldest ? end - oldest : 0);
+        hist[PL_LATENCY_NEWEST].Record(end > newest ? end - newest : 0);
+    }
+}
+
+
+// Copies records from the ring, starting at the client's cursor, into a
+// caller buffer through sink(record, k), which stores the record as the k-th
+// output and returns true, returns false to skip it, or returns -1 to stop
+// before it when the caller's buffer is full.  A sink taking a third argument
+// also gets the record's sequence number.  The selected lanes are merged by
+// timestamp, events first among equal timestamps.  Records outside the
+// client's subscription never reach the sink; the others reach it as
+// thinned by the client's decimation.  Stops after nmax accepted records.
+// The cursor advances past every record examined.  Returns the number of
+// accepted records.
+template <class Sink>
+static int ReadRecords(int nmax, Sink sink, int* serverdropped, int* mmfdropped,
+                       int* pollhigh, int* polllow)
+{
+    int accepted = 0;
+    uint64_t lost = 0;
+    uint64_t pollTime = 0;
+
+    if (g_Client && nmax > 0)
+    {
+        uint64_t start = PL_ShmNow();
+        uint64_t firstTs = 0, lastTs = 0;
+        PL_ShmHeader* hdr = g_Client->Header;
+        int numLanes = g_Client->NumLanes;
+        uint64_t r[PL_SHM_LANES], w[PL_SHM_LANES], i[PL_SHM_LANES];
+        for (int lane = 0; lane < numLanes; lane++)
+            r[lane] = GetReadIndex(lane);
+        g_Client->BatchCount = 0;
+        for (;;)
+        {
+            GetWriteIndexes(w);
+            LimitToReplay(w);
+            pollTime = hdr->PollTime.load(std::memory_order_relaxed);
+
+            //** skip whatever the server has already overwritten, and the
+            //** lanes the client does not read
+            for (int lane = 0; lane < numLanes; lane++)
+            {
+                uint64_t oldest = OldestIntact(lane, std::memory_order_acquire);
+                if (!IsSelected(lane))
+                    r[lane] = w[lane];
+                else if (r[lane] < oldest)
+                {
+                    NoteLost(lane, r[lane], oldest);
+                    lost += oldest - r[lane];
+                    r[lane] = oldest;
+                }
+                i[lane] = r[lane];
+            }
+
+            accepted = 0;
+            bool filtered = g_Client->Filtered;
+            CDecimator* decimator = g_Client->Decimator;
+            bool full = false;
+            while (!full && accepted < nmax)
+            {
+                //** the lane whose next record is the oldest, and how far it
+                //** can be read before the other lane's next record is due
+                int lane = -1;
+                uint64_t nextTs[PL_SHM_LANES];
+                for (int k = 0; k < numLanes; k++)
+                {
+                    if (i[k] >= w[k])
+                        continue;
+                    nextTs[k] = PL_ShmTimeStamp(g_Client->Lanes[k].Records[i[k] & g_Client->Lanes[k].Mask]);
+                    if (lane < 0 || nextTs[k] < nextTs[lane])
+                        lane = k;
+                }
+                if (lane < 0)
+                    break;
+                int other = 1 - lane;
+                uint64_t limit = numLanes > 1 && i[other] < w[other] ?
+                                 nextTs[other] - (lane == PL_SHM_LANE_CONTINUOUS) : ~(uint64_t)0;
+
+                const CLane& l = g_Client->Lanes[lane];
+                while (i[lane] < w[lane] && accepted < nmax)
+                {
+                    const PL_WaveLong& rec = l.Records[i[lane] & l.Mask];
+                    uint64_t ts = PL_ShmTimeStamp(rec);
+                    if (ts > limit)
+                        break;
+                    if (!filtered || Subscribed(g_Client->Subscription, rec))
+                    {
+                        CDecimateUndo undo;
+                        const PL_WaveLong* out = decimator ? Decimate(decimator, rec, &undo) : &rec;
+                        int result = 0;     //** nothing left of it to deliver if out is NULL
+                        if constexpr (std::is_invocable_v<Sink, const PL_WaveLong&, int, uint64_t>)
+                            result = out ? sink(*out, accepted, Sequence(lane, i[lane])) : 0;
+                        else
+                            result = out ? sink(*out, accepted) : 0;
+                        if (result < 0)
+                        {
+                            if (decimator)
+                                UndoDecimate(undo);
+                            full = true;
+                            break;
+                        }
+                        if (result)
+                        {
+                            lastTs = ts;
+                            if (accepted++ == 0)
+                                firstTs = lastTs;
+                        }
+                    }
+                    i[lane]++;
+                }
+            }
+
+            //** if the server overwrote any of the records while they were
+            //** being copied, drop the batch and read again from the oldest
+            //** intact record
+            std::atomic_thread_fence(std::memory_order_acquire);
+            bool intact = true;
+            for (int lane = 0; lane < numLanes; lane++)
+                intact &= r[lane] >= OldestIntact(lane, std::memory_order_relaxed);
+            if (intact)
+                break;
+        }
+        for (int lane = 0; lane < numLanes; lane++)
+            SetReadIndex(lane, i[lane], 0);
+        if (lost)
+            g_Client->Cursor->MMFDropped.fetch_add(lost, std::memory_order_relaxed);
+        RecordLatency(start, PL_ShmNow(), pollTime, firstTs, lastTs, accepted);
+    }
+
+    if (serverdropped)
+        *serverdropped = TakeServerDropped();
+    if (mmfdropped)
+        *mmfdropped = (int)lost;
+    SplitPollTime(pollTime, pollhigh, polllow);
+    return accepted;
+}
+
+
+// copy of the 16-byte record header
+static inline void CopyEvent(PL_Event* dst, const PL_WaveLong& src)
+{
+    memcpy(dst, &src, sizeof(PL_Event));
+}
+
+
+// copy of a long waveform record truncated to MAX_WF_LENGTH points
+static inline void CopyWave(PL_Wave* dst, const PL_WaveLong& src)
+{
+    memcpy(dst, &src, sizeof(PL_Wave));
+    if (dst->NumberOfDataWords > MAX_WF_LENGTH)
+        dst->NumberOfDataWords = MAX_WF_LENGTH;
+}
+
+
+// claims a free cursor slot, reclaiming slots of crashed clients
+static PL_ShmCursor* ClaimCursor(PL_ShmHeader* hdr, int type)
+{
+    for (int i = 0; i < PL_SERVER_MAX_CLIENTS; i++)
+    {
+        PL_ShmCursor* cursor = hdr->Cursors + i;
+        uint32_t state = cursor->State.load(std::memory_order_acquire);
+        if (PL_ShmCursorIsStale(cursor, state))
+        {
+            //** only one process gets to free a stale slot
+            if (!cursor->State.compare_exchange_strong(state, PL_CURSOR_FREE))
+                continue;
+            state = PL_CURSOR_FREE;
+        }
+        //** the claim carries the pid, so a client dying before the slot is
+        //** active still leaves it reclaimable
+        if (state == PL_CURSOR_FREE &&
+            cursor->State.compare_exchange_strong(state, PL_CURSOR_CLAIMING | (uint32_t)getpid()))
+        {
+            cursor->Pid = getpid();
+            cursor->Type = type;
+            cursor->MMFDropped.store(0, std::memory_order_relaxed);
+            cursor->ServerDropped.store(hdr->ServerDropped.load(std::memory_order_relaxed),
+                                        std::memory_order_relaxed);
+            for (int lane = 0; lane < PL_SHM_LANES; lane++)
+                cursor->ReadIndex[lane].store(hdr->Lanes[lane].WriteIndex.load(std::memory_order_acquire),
+                                              std::memory_order_relaxed);
+            for (int k = 0; k <= PL_SHM_WAKE_TOTAL; k++)
+                cursor->WakeAt[k].store(PL_WAKE_NEVER, std::memory_order_relaxed);
+            cursor->State.store(PL_CURSOR_ACTIVE, std::memory_order_release);
+            return cursor;
+        }
+    }
+    return NULL;
+}
+
+
+// Moves the new client's cursor back to the first record of every lane
+// published in the last millis ms (0 for all the ring holds), counted from
+// the newest record, and marks the records up to the current end as replayed.
+static void StartReplay(int millis)
+{
+    uint64_t w[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    uint64_t newest = 0;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        const CLane& l = g_Client->Lanes[lane];
+        uint64_t ts = w[lane] > 0 ? PL_ShmTimeStamp(l.Records[(w[lane] - 1) & l.Mask]) : 0;
+        if (ts > newest)
+            newest = ts;
+    }
+    int tick = ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.TimeStampTick; });
+    uint64_t span = millis > 0 && tick > 0 ? (uint64_t)millis*1000/(uint64_t)tick : newest;
+    uint64_t from = newest > span ? newest - span : 0;
+
+    g_Client->Replayed = true;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        uint64_t r = OldestIntact(lane, std::memory_order_acquire);
+        if (from > 0)
+            r = FirstAfter(lane, r, w[lane], from - 1);
+        SetReadIndex(lane, r, 0);
+        g_Client->ReplayEnd[lane] = w[lane];
+        g_Client->Replaying |= r < w[lane];
+    }
+}
+
+
+extern "C" int WINAPI PL_InitClientEx4(int type, const PL_ClientOptions* options)
+{
+    if (g_Client)
+        return 1;
+
+    //** options of an older, smaller PL_ClientOptions keep their defaults
+    PL_ClientOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    if (options)
+    {
+        if (options->Size < (int)(offsetof(PL_ClientOptions, Flags) + sizeof(int)))
+            return 0;
+        memcpy(&opts, options, (size_t)options->Size < sizeof(opts) ? (size_t)options->Size : sizeof(opts));
+    }
+    opts.Size = sizeof(opts);
+
+    int fd = shm_open(PL_ShmName(NULL), O_RDWR, 0);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < PL_ShmHeaderSize())
+    {
+        close(fd);
+        return 0;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+
+    PL_ShmHeader* hdr = (PL_ShmHeader*)p;
+    if (hdr->Magic != PL_SHM_MAGIC || hdr->Version != PL_SHM_VERSION ||
+        hdr->RecordSize != sizeof(PL_WaveLong) ||
+        hdr->Lanes[PL_SHM_LANE_EVENTS].Capacity < 2 ||
+        PL_ShmSize(hdr->Lanes[PL_SHM_LANE_EVENTS].Capacity,
+                   hdr->Lanes[PL_SHM_LANE_CONTINUOUS].Capacity) > (size_t)st.st_size)
+    {
+        munmap(p, (size_t)st.st_size);
+        return 0;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    PL_ShmCursor* cursor = ClaimCursor(hdr, type);
+    if (!cursor)
+    {
+        fprintf(stderr, "PL_InitClientEx3: too many clients connected\n");
+        munmap(p, (size_t)st.st_size);
+        return 0;
+    }
+
+    g_Client = new CClient();
+    g_Client->Size = (size_t)st.st_size;
+    g_Client->Header = hdr;
+    for (int lane = 0; lane < PL_SHM_LANES; lane++)
+    {
+        CLane& l = g_Client->Lanes[lane];
+        uint64_t capacity = hdr->Lanes[lane].Capacity;
+        l.Records = PL_ShmRecords(hdr, lane);
+        l.Mask = capacity - 1;
+        l.Shadow = PL_ShmShadow(hdr, lane);
+        l.ShadowMask = capacity*PL_SHM_SHADOW_FACTOR - 1;
+    }
+    g_Client->NumLanes = hdr->Lanes[PL_SHM_LANE_CONTINUOUS].Capacity ? 2 : 1;
+    g_Client->Selected = (1u << g_Client->NumLanes) - 1;
+    g_Client->Cursor = cursor;
+    g_Client->Options = opts;
+    g_Client->Spin.Applied = opts.Flags & PL_CLIENT_BUSY_POLL;
+    if (opts.Flags & PL_CLIENT_LOCK_MEMORY)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+            g_Client->Spin.Applied |= PL_CLIENT_LOCK_MEMORY;
+        else
+            perror("PL_InitClientEx4: mlockall");
+    }
+    PL_ResetDropStats();
+    if (opts.Flags & PL_CLIENT_REPLAY)
+        StartReplay(opts.ReplayMillis);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_InitClientEx3(int type, HWND hWndList, HWND hWndMain)
+{
+    (void)hWndList; (void)hWndMain;
+    return PL_InitClientEx4(type, NULL);
+}
+
+
+extern "C" int WINAPI PL_InitClient(int type, HWND hWndList)
+{
+    return PL_InitClientEx3(type, hWndList, NULL);
+}
+
+
+extern "C" int WINAPI PL_InitClientEx2(int type, HWND hWndMain)
+{
+    return PL_InitClientEx3(type, NULL, hWndMain);
+}
+
+
+extern "C" void WINAPI PL_CloseClient()
+{
+    if (!g_Client)
+        return;
+    PL_StopDispatch();
+    if (g_Client->Spin.Applied & PL_CLIENT_LOCK_MEMORY)
+        munlockall();
+    g_Client->Cursor->State.store(PL_CURSOR_FREE, std::memory_order_release);
+    munmap(g_Client->Header, g_Client->Size);
+    delete g_Client->Decimator;
+    delete g_Client;
+    g_Client = NULL;
+}
+
+
+extern "C" void WINAPI PL_GetTimeStampArrays(int* pnmax, short* type, short* ch,
+                                             short* cl, int* ts)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        type[k] = rec.Type;
+        ch[k] = rec.Channel;
+        cl[k] = rec.Unit;
+        ts[k] = (int)rec.TimeStamp;
+        return true;
+    }, NULL, NULL, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetTimeStampArraysEx(int* pnmax, short* type, short* ch,
+                                               short* unit, unsigned long long* ts,
+                                               short* nwords, short* waves, int wflength)
+{
+    if (wflength < 0)
+        wflength = 0;
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        if (type)
+            type[k] = rec.Type;
+        if (ch)
+            ch[k] = rec.Channel;
+        if (unit)
+            unit[k] = rec.Unit;
+        if (ts)
+            ts[k] = ((unsigned long long)rec.UpperTS << 32) | rec.TimeStamp;
+        int n = rec.NumberOfDataWords < 0 ? 0 : rec.NumberOfDataWords;
+        if (n > MAX_WF_LENGTH_LONG)
+            n = MAX_WF_LENGTH_LONG;
+        if (nwords)
+            nwords[k] = (short)n;
+        if (waves)
+        {
+            short* row = waves + (size_t)k*wflength;
+            if (n > wflength)
+                n = wflength;
+            memcpy(row, rec.WaveForm, n*sizeof(short));
+            memset(row + n, 0, (wflength - n)*sizeof(short));
+        }
+        return true;
+    }, NULL, NULL, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetTimeStampStructures(int* pnmax, PL_Event* events)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        CopyEvent(events + k, rec);
+        return true;
+    }, NULL, NULL, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetTimeStampStructuresEx(int* pnmax, PL_Event* events,
+                                                   int* pollhigh, int* polllow)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        CopyEvent(events + k, rec);
+        return true;
+    }, NULL, NULL, pollhigh, polllow);
+}
+
+
+extern "C" void WINAPI PL_GetTimeStampStructuresEx2(int* pnmax, PL_Event* events,
+                                                    int includeContinuous)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        if (!includeContinuous && rec.Type == PL_ADDataType)
+            return false;
+        CopyEvent(events + k, rec);
+        return true;
+    }, NULL, NULL, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetWaveFormStructures(int* pnmax, PL_Wave* waves)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        CopyWave(waves + k, rec);
+        return true;
+    }, NULL, NULL, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetWaveFormStructuresEx(int* pnmax, PL_Wave* waves,
+                                                  int* serverdropped, int* mmfdropped)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        CopyWave(waves + k, rec);
+        return true;
+    }, serverdropped, mmfdropped, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetWaveFormStructuresEx2(int* pnmax, PL_Wave* waves,
+                                                   int* serverdropped, int* mmfdropped,
+                                                   int* pollhigh, int* polllow)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        CopyWave(waves + k, rec);
+        return true;
+    }, serverdropped, mmfdropped, pollhigh, polllow);
+}
+
+
+extern "C" void WINAPI PL_GetLongWaveFormStructures(int* pnmax, PL_WaveLong* waves,
+                                                    int* serverdropped, int* mmfdropped)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        waves[k] = rec;
+        return true;
+    }, serverdropped, mmfdropped, NULL, NULL);
+}
+
+
+extern "C" void WINAPI PL_GetLongWaveFormStructuresEx2(int* pnmax, PL_WaveLong* waves,
+                                                       int* serverdropped, int* mmfdropped,
+                                                       int* pollhigh, int* polllow)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k) {
+        waves[k] = rec;
+        return true;
+    }, serverdropped, mmfdropped, pollhigh, polllow);
+}
+
+
+extern "C" void WINAPI PL_GetLongWaveFormStructuresSeq(int* pnmax, PL_WaveLong* waves,
+                                                       unsigned long long* sequences,
+                                                       int* serverdropped, int* mmfdropped,
+                                                       int* pollhigh, int* polllow)
+{
+    *pnmax = ReadRecords(*pnmax, [=](const PL_WaveLong& rec, int k, uint64_t seq) {
+        waves[k] = rec;
+        if (sequences)
+            sequences[k] = seq;
+        return true;
+    }, serverdropped, mmfdropped, pollhigh, polllow);
+}
+
+
+extern "C" void WINAPI PL_GetPackedWaveForms(int* pnmax, void* buffer, int* bufsize,
+                                             int* offsets, int* serverdropped, int* mmfdropped)
+{
+    char* out = (char*)buffer;
+    int size = *bufsize;
+    int used = 0;
+    *pnmax = ReadRecords(*pnmax, [&](const PL_WaveLong& rec, int k) -> int {
+        if (k == 0)
+            used = 0; //** ReadRecords starts over after an overrun
+        int n = rec.NumberOfDataWords < 0 ? 0 : rec.NumberOfDataWords;
+        if (n > MAX_WF_LENGTH_LONG)
+            n = MAX_WF_LENGTH_LONG;
+        int packed = (int)PL_PACKED_RECORD_SIZE(n);
+        if (used + packed > size)
+            return -1;
+        if (offsets)
+            offsets[k] = used;
+        memcpy(out + used, &rec, sizeof(PL_Event) + n*sizeof(short));
+        ((PL_Event*)(out + used))->NumberOfDataWords = (char)n;
+        used += packed;
+        return 1;
+    }, serverdropped, mmfdropped, NULL, NULL);
+    *bufsize = used;
+}
+
+
+extern "C" int WINAPI PL_AcquireBatch(int nmax, PL_Batch* batch)
+{
+    memset(batch, 0, sizeof(*batch));
+    if (!g_Client || nmax <= 0)
+        return 0;
+    uint64_t start = PL_ShmNow();
+
+    //** a batch that was never released is given back unread
+    g_Client->BatchCount = 0;
+
+    PL_ShmHeader* hdr = g_Client->Header;
+    int numLanes = g_Client->NumLanes;
+    uint64_t w[PL_SHM_LANES], r[PL_SHM_LANES] = { 0 }, nextTs[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    LimitToReplay(w);
+    int lane = -1;
+    for (int k = 0; k < numLanes; k++)
+    {
+        uint64_t oldest = OldestIntact(k, std::memory_order_acquire);
+        uint64_t lost = 0;
+        r[k] = GetReadIndex(k);
+        if (!IsSelected(k))
+            r[k] = w[k];
+        else if (r[k] < oldest)
+        {
+            NoteLost(k, r[k], oldest);
+            lost = oldest - r[k];
+            r[k] = oldest;
+        }
+        SetReadIndex(k, r[k], lost);
+        batch->MMFDropped += (int)lost;
+
+        //** the batch comes from the lane whose next record is the oldest
+        if (r[k] < w[k])
+        {
+            nextTs[k] = PL_ShmTimeStamp(g_Client->Lanes[k].Records[r[k] & g_Client->Lanes[k].Mask]);
+            if (lane < 0 || nextTs[k] < nextTs[lane])
+                lane = k;
+        }
+    }
+
+    uint64_t count = 0;
+    if (lane >= 0)
+    {
+        count = w[lane] - r[lane];
+        if (count > (uint64_t)nmax)
+            count = (uint64_t)nmax;
+
+        //** and stops where the other lane's next record is due, events first
+        int other = 1 - lane;
+        if (numLanes > 1 && r[other] < w[other])
+            count = FirstAfter(lane, r[lane], r[lane] + count,
+                               nextTs[other] - (lane == PL_SHM_LANE_CONTINUOUS)) - r[lane];
+    }
+    else
+        lane = PL_SHM_LANE_EVENTS;
+
+    const CLane& l = g_Client->Lanes[lane];
+    uint64_t slot = r[lane] & l.Mask;
+    uint64_t first = l.Mask + 1 - slot;
+    if (first > count)
+        first = count;
+
+    batch->Spans[0].Records = l.Records + slot;
+    batch->Spans[0].Count = (int)first;
+    batch->Spans[1].Records = l.Records;
+    batch->Spans[1].Count = (int)(count - first);
+    batch->NumRecords = (int)count;
+    batch->ServerDropped = TakeServerDropped();
+    uint64_t pollTime = hdr->PollTime.load(std::memory_order_relaxed);
+    SplitPollTime(pollTime, &batch->PollHigh, &batch->PollLow);
+    batch->FirstSequence = Sequence(lane, r[lane]);
+    batch->Replayed = g_Client->Replaying && count > 0;
+    if (count > 0)
+        RecordLatency(start, PL_ShmNow(), pollTime, PL_ShmTimeStamp(l.Records[r[lane] & l.Mask]),
+                      PL_ShmTimeStamp(l.Records[(r[lane] + count - 1) & l.Mask]), (int)count);
+    else
+        RecordLatency(start, PL_ShmNow(), pollTime, 0, 0, 0);
+
+    g_Client->BatchLane = lane;
+    g_Client->BatchStart = r[lane];
+    g_Client->BatchCount = count;
+    return (int)count;
+}
+
+
+extern "C" int WINAPI PL_ReleaseBatch(int count)
+{
+    if (!g_Client || g_Client->BatchCount == 0)
+        return 0;
+    if (count < 0)
+        count = 0;
+    if ((uint64_t)count > g_Client->BatchCount)
+        count = (int)g_Client->BatchCount;
+
+    //** the records were read in place, so they are only good if the server
+    //** has not started to overwrite them in the meantime
+    int lane = g_Client->BatchLane;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    int intact = g_Client->BatchStart >= OldestIntact(lane, std::memory_order_relaxed);
+
+    SetReadIndex(lane, g_Client->BatchStart + (uint64_t)count, 0);
+    g_Client->BatchCount = 0;
+    return intact;
+}
+
+
+extern "C" int WINAPI PL_GetPendingCount()
+{
+    if (!g_Client)
+        return 0;
+    uint64_t w[PL_SHM_LANES], r[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+        r[lane] = GetReadIndex(lane);
+    return (int)Pending(w, r);
+}
+
+
+extern "C" int WINAPI PL_SkipToTimeStamp(unsigned long long ts)
+{
+    if (!g_Client)
+        return 0;
+    g_Client->BatchCount = 0;
+
+    uint64_t w[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    uint64_t skipped = 0;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        uint64_t start = GetReadIndex(lane);
+        uint64_t lo = start;
+        uint64_t oldest = OldestIntact(lane, std::memory_order_acquire);
+        if (lo < oldest)
+            lo = oldest;
+
+        //** the server publishes each lane in timestamp order: find the
+        //** first record at or after ts
+        lo = ts ? FirstAfter(lane, lo, w[lane], ts - 1) : lo;
+
+        //** records overwritten during the search are gone anyway
+        std::atomic_thread_fence(std::memory_order_acquire);
+        oldest = OldestIntact(lane, std::memory_order_relaxed);
+        if (lo < oldest)
+            lo = oldest;
+        SetReadIndex(lane, lo, 0);
+        if (IsSelected(lane))
+            skipped += lo - start;
+    }
+    return (int)skipped;
+}
+
+
+extern "C" int WINAPI PL_SkipToLatest()
+{
+    if (!g_Client)
+        return 0;
+    g_Client->BatchCount = 0;
+    uint64_t w[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    uint64_t skipped = 0;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        uint64_t start = GetReadIndex(lane);
+        SetReadIndex(lane, w[lane], 0);
+        if (IsSelected(lane))
+            skipped += w[lane] - start;
+    }
+    return (int)skipped;
+}
+
+
+extern "C" void WINAPI PL_SubscriptionInit(PL_Subscription* sub, int all)
+{
+    memset(sub, all ? 0xff : 0, sizeof(*sub));
+    sub->UnitMask = ~0u;
+}
+
+
+extern "C" void WINAPI PL_SubscriptionAddChannels(PL_Subscription* sub, int type, int first, int last)
+{
+    if (type < 0 || type > PL_SUB_MAX_TYPE)
+        return;
+    if (first < 0)
+        first = 0;
+    if (last >= PL_SUB_MAX_CHANNEL)
+        last = PL_SUB_MAX_CHANNEL - 1;
+    sub->TypeMask |= 1u << type;
+    for (int ch = first; ch <= last; ch++)
+        sub->ChannelMask[type][ch >> 5] |= 1u << (ch & 31);
+}
+
+
+extern "C" void WINAPI PL_SetSubscription(const PL_Subscription* sub)
+{
+    if (!g_Client)
+        return;
+    g_Client->Filtered = sub != NULL;
+    if (sub)
+        g_Client->Subscription = *sub;
+}
+
+
+extern "C" int WINAPI PL_SetDecimation(const PL_Decimation* decimation)
+{
+    if (!g_Client)
+        return 0;
+    if (!decimation)
+    {
+        delete g_Client->Decimator;
+        g_Client->Decimator = NULL;
+        return 1;
+    }
+    if (decimation->WaveformRate < 0 || decimation->ContinuousFactor < 0 ||
+        decimation->ContinuousMode < PL_DECIMATE_PICK || decimation->ContinuousMode > PL_DECIMATE_ENVELOPE)
+        return 0;
+
+    //** waveform slots and the sample grids are placed in timestamp ticks
+    CDecimator* d = new CDecimator();
+    d->Settings = *decimation;
+    int tick = 0;
+    ReadConfig([&](const PL_ConfigSnapshot& c) {
+        tick = c.Info.TimeStampTick;
+        for (int ch = 0; ch < PL_SUB_MAX_CHANNEL; ch++)
+        {
+            int freq = ch < PL_CONFIG_MAX_SLOW_CHANNELS ? c.SlowFrequencies[ch] : c.Info.SlowFrequency;
+            d->SampleRate[ch] = freq > 0 ? (uint32_t)freq : 0;
+        }
+    });
+    if (tick <= 0 || 1000000 % tick != 0)
+    {
+        delete d;
+        return 0;
+    }
+    d->TickRate = 1000000/tick;
+    delete g_Client->Decimator;
+    g_Client->Decimator = d;
+    return 1;
+}
+
+
+// pins the calling thread and switches it to SCHED_FIFO, as asked for in
+// PL_InitClientEx4; done once, for the first thread that waits
+static void SetUpWaitingThread()
+{
+    if (g_Client->ThreadSetUp.exchange(true))
+        return;
+    const PL_ClientOptions& opts = g_Client->Options;
+    if (opts.Flags & PL_CLIENT_PIN_CPU)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(opts.Cpu, &cpus);
+        int err = opts.Cpu >= 0 && opts.Cpu < CPU_SETSIZE ?
+                  pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) : EINVAL;
+        if (err == 0)
+            g_Client->Spin.Applied |= PL_CLIENT_PIN_CPU;
+        else
+            fprintf(stderr, "PL_WaitForData: cannot pin to cpu %d: %s\n", opts.Cpu, strerror(err));
+    }
+    if (opts.Flags & PL_CLIENT_REALTIME)
+    {
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = opts.Priority > 0 ? opts.Priority : 50;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err == 0)
+            g_Client->Spin.Applied |= PL_CLIENT_REALTIME;
+        else
+            fprintf(stderr, "PL_WaitForData: cannot use SCHED_FIFO: %s\n", strerror(err));
+    }
+}
+
+
+// lets the other hyperthread of the core run while spinning
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+
+// PL_WaitForData with PL_CLIENT_BUSY_POLL: polls the write indexes until
+// enough records are published in the selected lanes, the deadline (0 for
+// none) passes or the server closes; leaves the last write indexes seen in w
+static void SpinForData(const uint64_t* r, uint64_t want, uint64_t deadline, uint64_t* w)
+{
+    PL_ShmHeader* hdr = g_Client->Header;
+    uint64_t polls = 0;
+    for (;;)
+    {
+        polls++;
+        GetWriteIndexes(w);
+        if (Pending(w, r) >= want || hdr->Closed.load(std::memory_order_relaxed))
+            break;
+        //** reading the clock costs more than a poll, so only check the deadline now and then
+        if (deadline && (polls & 63) == 0 && PL_ShmNow() >= deadline)
+            break;
+        CpuRelax();
+    }
+    g_Client->Spin.Polls += polls;
+}
+
+
+// PL_WaitForData without PL_CLIENT_BUSY_POLL: sleeps on the cursor's futex
+// until enough records are published in the selected lanes, the deadline (0
+// for none) passes or the server closes; leaves the last write indexes seen
+// in w
+static void SleepForData(const uint64_t* r, uint64_t want, uint64_t deadline, uint64_t* w)
+{
+    PL_ShmHeader* hdr = g_Client->Header;
+    PL_ShmCursor* cursor = g_Client->Cursor;
+
+    //** the server wakes the client when the one lane it reads, or the sum of
+    //** both lanes, reaches the wake index
+    int wakeAt = PL_SHM_WAKE_TOTAL;
+    uint64_t wakeIndex = want;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+        if (IsSelected(lane))
+            wakeIndex += r[lane];
+    if (g_Client->Selected == 1u << PL_SHM_LANE_EVENTS)
+        wakeAt = PL_SHM_LANE_EVENTS;
+    else if (g_Client->Selected == 1u << PL_SHM_LANE_CONTINUOUS)
+        wakeAt = PL_SHM_LANE_CONTINUOUS;
+
+    for (;;)
+    {
+        g_Client->Spin.Polls++;
+        uint32_t seq = cursor->WakeSeq.load(std::memory_order_acquire);
+        cursor->WakeAt[wakeAt].store(wakeIndex, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        GetWriteIndexes(w);
+        if (Pending(w, r) >= want || hdr->Closed.load(std::memory_order_relaxed))
+            break;
+
+        timespec rel;
+        timespec* timeout = NULL;
+        if (deadline)
+        {
+            uint64_t now = PL_ShmNow();
+            if (now >= deadline)
+                break;
+            rel.tv_sec = (time_t)((deadline - now)/1000000000);
+            rel.tv_nsec = (long)((deadline - now)%1000000000);
+            timeout = &rel;
+        }
+        PL_ShmFutexWait(&cursor->WakeSeq, seq, timeout);
+    }
+    cursor->WakeAt[wakeAt].store(PL_WAKE_NEVER, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+
+extern "C" int WINAPI PL_WaitForData(int minEvents, int maxWaitMicros)
+{
+    if (!g_Client)
+        return -1;
+
+    PL_ShmHeader* hdr = g_Client->Header;
+    uint64_t capacity = 0;
+    uint64_t r[PL_SHM_LANES], w[PL_SHM_LANES];
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        r[lane] = GetReadIndex(lane);
+        if (IsSelected(lane))
+            capacity += g_Client->Lanes[lane].Mask + 1;
+    }
+    uint64_t want = minEvents > 1 ? (uint64_t)minEvents : 1;
+    if (want > capacity)
+        want = capacity;
+
+    if (maxWaitMicros == 0 || want == 0)
+        GetWriteIndexes(w);
+    else
+    {
+        SetUpWaitingThread();
+        PL_SpinStats& spin = g_Client->Spin;
+        uint64_t start = PL_ShmNow();
+        if (g_Client->LastWaitEnd)
+            spin.WorkNanos += start - g_Client->LastWaitEnd;
+        spin.Waits++;
+        uint64_t deadline = maxWaitMicros > 0 ? start + (uint64_t)maxWaitMicros*1000 : 0;
+        if (g_Client->Options.Flags & PL_CLIENT_BUSY_POLL)
+            SpinForData(r, want, deadline, w);
+        else
+            SleepForData(r, want, deadline, w);
+        g_Client->LastWaitEnd = PL_ShmNow();
+        spin.WaitNanos += g_Client->LastWaitEnd - start;
+    }
+
+    uint64_t pending = Pending(w, r);
+    if (hdr->Closed.load(std::memory_order_relaxed) && pending == 0)
+        return -1;
+    return (int)pending;
+}
+
+
+extern "C" int WINAPI PL_GetSpinStats(PL_SpinStats* stats)
+{
+    if (!g_Client || !stats)
+        return 0;
+    *stats = g_Client->Spin;
+    return 1;
+}
+
+
+extern "C" void WINAPI PL_ResetSpinStats()
+{
+    if (!g_Client)
+        return;
+    int applied = g_Client->Spin.Applied;
+    memset(&g_Client->Spin, 0, sizeof(g_Client->Spin));
+    g_Client->Spin.Applied = applied;
+    g_Client->LastWaitEnd = 0;
+}
+
+
+extern "C" int WINAPI PL_GetStreamPosition(PL_StreamPosition* position)
+{
+    if (!g_Client || !position)
+        return 0;
+    position->Session = g_Client->Header->Session;
+    position->Sequence = GetReadIndex(PL_SHM_LANE_EVENTS);
+    position->ContinuousSequence = Sequence(PL_SHM_LANE_CONTINUOUS, GetReadIndex(PL_SHM_LANE_CONTINUOUS));
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_GetSequenceGaps(PL_SequenceGap* gaps, int nmax)
+{
+    if (!g_Client || !gaps || nmax <= 0)
+        return 0;
+    uint64_t count = g_Client->GapCount;
+    uint64_t first = g_Client->GapsTaken;
+    if (count - first > PL_SEQUENCE_MAX_GAPS)
+        first = count - PL_SEQUENCE_MAX_GAPS;
+    int n = 0;
+    for (uint64_t i = first; i < count && n < nmax; i++)
+        gaps[n++] = g_Client->Gaps[i % PL_SEQUENCE_MAX_GAPS];
+    //** gaps that did not fit are left for the next call
+    g_Client->GapsTaken = first + n;
+    return n;
+}
+
+
+extern "C" int WINAPI PL_ResumeClient(int type, const PL_ClientOptions* options,
+                                      const PL_StreamPosition* from)
+{
+    if (!PL_InitClientEx4(type, options))
+        return 0;
+    if (!from)
+        return PL_RESUME_NEW_SESSION;
+
+    //** a position past the newest record cannot come from this session either
+    PL_ShmHeader* hdr = g_Client->Header;
+    uint64_t w[PL_SHM_LANES];
+    uint64_t seq[PL_SHM_LANES] = { from->Sequence, from->ContinuousSequence & ~PL_SEQUENCE_CONTINUOUS };
+    GetWriteIndexes(w);
+    if (from->Session != hdr->Session)
+        return PL_RESUME_NEW_SESSION;
+    for (int lane = 0; lane < PL_SHM_LANES; lane++)
+        if (seq[lane] > w[lane])
+            return PL_RESUME_NEW_SESSION;
+
+    //** records already overwritten are found and reported by the next read
+    g_Client->BatchCount = 0;
+    g_Client->Replaying = g_Client->Replayed = false;
+    int result = PL_RESUME_EXACT;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+    {
+        SetReadIndex(lane, seq[lane], 0);
+        if (IsSelected(lane) && seq[lane] < OldestIntact(lane, std::memory_order_acquire))
+            result = PL_RESUME_PARTIAL;
+    }
+    return result;
+}
+
+
+extern "C" int WINAPI PL_GetReplayPending()
+{
+    if (!g_Client)
+        return 0;
+    uint64_t w[PL_SHM_LANES], r[PL_SHM_LANES];
+    GetWriteIndexes(w);
+    LimitToReplay(w);
+    if (!g_Client->Replaying)
+        return 0;
+    for (int lane = 0; lane < g_Client->NumLanes; lane++)
+        r[lane] = GetReadIndex(lane);
+    return (int)Pending(w, r);
+}
+
+
+extern "C" int WINAPI PL_GetReplayEnd(PL_StreamPosition* end)
+{
+    if (!g_Client || !end || !g_Client->Replayed)
+        return 0;
+    end->Session = g_Client->Header->Session;
+    end->Sequence = g_Client->ReplayEnd[PL_SHM_LANE_EVENTS];
+    end->ContinuousSequence = Sequence(PL_SHM_LANE_CONTINUOUS, g_Client->ReplayEnd[PL_SHM_LANE_CONTINUOUS]);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_SelectLanes(int lanes)
+{
+    if (!g_Client || ((unsigned)lanes & PL_LANE_ALL) == 0)
+        return 0;
+    if (g_Client->NumLanes == 1)
+        return PL_LANE_EVENTS;
+    g_Client->BatchCount = 0;
+    g_Client->Selected = (unsigned)lanes & PL_LANE_ALL;
+    return PL_LANE_ALL;
+}
+
+
+// Fits the clock model to the clock samples in the segment, if the server
+// has added any since the last fit.  Returns false if there are no samples.
+static bool FitClock()
+{
+    if (!g_Client)
+        return false;
+    PL_ShmHeader* hdr = g_Client->Header;
+    if (hdr->ClockCount.load(std::memory_order_acquire) == g_Client->ClockCount)
+        return g_Client->ClockCount > 0;
+
+    PL_ShmClockSample samples[PL_SHM_CLOCK_SAMPLES];
+    uint64_t count;
+    int n;
+    for (;;)
+    {
+        uint64_t seq = hdr->ClockSeq.load(std::memory_order_acquire);
+        if (seq & 1)
+        {
+            sched_yield();
+            continue;
+        }
+        count = hdr->ClockCount.load(std::memory_order_relaxed);
+        n = count < PL_SHM_CLOCK_SAMPLES ? (int)count : PL_SHM_CLOCK_SAMPLES;
+        for (int i = 0; i < n; i++)
+            samples[i] = hdr->Clock[(count - n + i) % PL_SHM_CLOCK_SAMPLES];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (hdr->ClockSeq.load(std::memory_order_relaxed) == seq)
+            break;
+    }
+    if (n == 0)
+        return false;
+
+    //** least squares of host time against timestamp, relative to the
+    //** newest sample so that the sums stay well within double precision
+    const PL_ShmClockSample& ref = samples[n - 1];
+    double nominal = ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.TimeStampTick; })*1000.0;
+    double mx = 0, my = 0;
+    for (int i = 0; i < n; i++)
+    {
+        mx += (double)(int64_t)(samples[i].TimeStamp - ref.TimeStamp);
+        my += (double)(int64_t)(samples[i].HostNanos - ref.HostNanos);
+    }
+    mx /= n;
+    my /= n;
+    double sxx = 0, sxy = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double x = (double)(int64_t)(samples[i].TimeStamp - ref.TimeStamp) - mx;
+        double y = (double)(int64_t)(samples[i].HostNanos - ref.HostNanos) - my;
+        sxx += x*x;
+        sxy += x*y;
+    }
+    double slope = sxx > 0 ? sxy/sxx : nominal;
+    double offset = my - slope*mx;     //** fitted host time at ref.TimeStamp, relative to ref.HostNanos
+    double sumsq = 0;
+    for (int i = 0; i < n; i++)
+    {
+        double x = (double)(int64_t)(samples[i].TimeStamp - ref.TimeStamp);
+        double y = (double)(int64_t)(samples[i].HostNanos - ref.HostNanos);
+        double e = y - (offset + slope*x);
+        sumsq += e*e;
+    }
+
+    PL_ClockModel& model = g_Client->Clock;
+    model.RefTimeStamp = ref.TimeStamp;
+    model.RefHostNanos = ref.HostNanos + (uint64_t)(int64_t)llround(offset);
+    model.NanosPerTick = slope;
+    model.DriftPPM = nominal > 0 ? (slope/nominal - 1.0)*1e6 : 0;
+    model.ResidualNanos = sqrt(sumsq/n);
+    model.NumSamples = n;
+    g_Client->ClockCount = count;
+    return true;
+}
+
+
+extern "C" int WINAPI PL_GetClockModel(PL_ClockModel* model)
+{
+    if (!FitClock())
+        return 0;
+    *model = g_Client->Clock;
+    return 1;
+}
+
+
+extern "C" unsigned long long WINAPI PL_MapTimeToHost(unsigned long long ts)
+{
+    if (!FitClock())
+        return 0;
+    const PL_ClockModel& model = g_Client->Clock;
+    double dt = (double)(int64_t)(ts - model.RefTimeStamp)*model.NanosPerTick;
+    return model.RefHostNanos + (uint64_t)(int64_t)llround(dt);
+}
+
+
+extern "C" unsigned long long WINAPI PL_HostTimeToMap(unsigned long long hostNanos)
+{
+    if (!FitClock() || g_Client->Clock.NanosPerTick <= 0)
+        return 0;
+    const PL_ClockModel& model = g_Client->Clock;
+    double dt = (double)(int64_t)(hostNanos - model.RefHostNanos)/model.NanosPerTick;
+    return model.RefTimeStamp + (uint64_t)(int64_t)llround(dt);
+}
+
+
+extern "C" unsigned long long WINAPI PL_GetHostTime()
+{
+    return PL_ShmNow();
+}
+
+
+extern "C" int WINAPI PL_SendUserEvents(const PL_UserEvent* events, int n)
+{
+    if (!g_Client || !events || n <= 0 || n > PL_USER_EVENT_MAX_BATCH)
+        return 0;
+
+    PL_ShmHeader* hdr = g_Client->Header;
+    uint32_t filling = PL_USER_BATCH_FILLING | ((uint32_t)getpid() << 2);
+    for (int i = 0; i < PL_SHM_USER_BATCHES; i++)
+    {
+        PL_ShmUserBatch* batch = hdr->UserBatches + i;
+        uint32_t state = PL_USER_BATCH_FREE;
+        if (!batch->State.compare_exchange_strong(state, filling, std::memory_order_acquire))
+            continue;
+        memcpy(batch->Events, events, n*sizeof(PL_UserEvent));
+        batch->Count = (uint32_t)n;
+        batch->Ticket = hdr->UserTicket.fetch_add(1, std::memory_order_relaxed);
+        batch->State.store(PL_USER_BATCH_READY, std::memory_order_release);
+        return 1;
+    }
+    return 0;
+}
+
+
+extern "C" void WINAPI PL_SendUserEvent(int channel)
+{
+    PL_UserEvent event = { channel, 0, 0 };
+    PL_SendUserEvents(&event, 1);
+}
+
+
+extern "C" void WINAPI PL_SendUserEventWord(WORD w)
+{
+    PL_UserEvent event = { PL_StrobedExtChannel, w, 0 };
+    PL_SendUserEvents(&event, 1);
+}
+
+
+extern "C" int WINAPI PL_GetLatencyStats(int which, PL_LatencyStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!g_Client || which < 0 || which >= PL_LATENCY_COUNT)
+        return 0;
+    const CHistogram& hist = g_Client->Latency[which];
+    stats->Count = hist.Total;
+    stats->MinNanos = hist.Min;
+    stats->MaxNanos = hist.Max;
+    stats->MeanNanos = hist.Total ? hist.Sum/(double)hist.Total : 0;
+    stats->P50Nanos = hist.Percentile(50);
+    stats->P90Nanos = hist.Percentile(90);
+    stats->P99Nanos = hist.Percentile(99);
+    stats->P999Nanos = hist.Percentile(99.9);
+    return 1;
+}
+
+
+extern "C" unsigned long long WINAPI PL_GetLatencyPercentile(int which, double percent)
+{
+    if (!g_Client || which < 0 || which >= PL_LATENCY_COUNT)
+        return 0;
+    return g_Client->Latency[which].Percentile(percent);
+}
+
+
+extern "C" int WINAPI PL_GetLatencyHistogram(int which, unsigned long long* lower,
+                                             unsigned long long* counts, int nmax)
+{
+    if (!g_Client || which < 0 || which >= PL_LATENCY_COUNT)
+        return 0;
+    const CHistogram& hist = g_Client->Latency[which];
+    int n = 0;
+    for (int i = 0; i < PL_HIST_BUCKETS; i++)
+    {
+        if (!hist.Counts[i])
+            continue;
+        if (n < nmax)
+        {
+            lower[n] = CHistogram::LowerBound(i);
+            counts[n] = hist.Counts[i];
+        }
+        n++;
+    }
+    return n;
+}
+
+
+extern "C" void WINAPI PL_ResetLatencyStats()
+{
+    if (!g_Client)
+        return;
+    for (int i = 0; i < PL_LATENCY_COUNT; i++)
+        g_Client->Latency[i].Reset();
+    g_Client->LastReadStart = 0;
+}
+
+
+// adds the drops of one type and channel to stats
+static void AddDrops(PL_DropStats* stats, unsigned type, unsigned ch)
+{
+    const PL_ShmDropCounter& counter = g_Client->Header->ServerDrops[type][ch];
+    stats->MMFDropped += g_Client->MMFDrops[type][ch];
+    stats->ServerDropped += counter.Count.load(std::memory_order_relaxed) - g_Client->ServerDropsBase[type][ch];
+    if (g_Client->MMFDropTimeStamp[type][ch] > stats->LastMMFDropTimeStamp)
+        stats->LastMMFDropTimeStamp = g_Client->MMFDropTimeStamp[type][ch];
+    uint64_t ts = counter.LastTimeStamp.load(std::memory_order_relaxed);
+    if (counter.Count.load(std::memory_order_relaxed) != g_Client->ServerDropsBase[type][ch] &&
+        ts > stats->LastServerDropTimeStamp)
+        stats->LastServerDropTimeStamp = ts;
+}
+
+
+extern "C" int WINAPI PL_GetDropStats(int type, int channel, PL_DropStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (!g_Client || type < PL_DROP_UNATTRIBUTED || type > PL_SUB_MAX_TYPE ||
+        channel < PL_DROP_ALL || channel >= PL_SUB_MAX_CHANNEL)
+        return 0;
+
+    if (type == PL_DROP_UNATTRIBUTED || type == PL_DROP_ALL)
+    {
+        PL_ShmHeader* hdr = g_Client->Header;
+        stats->MMFDropped = g_Client->MMFDropsUnattributed;
+        stats->ServerDropped = (hdr->ServerDropped.load(std::memory_order_relaxed) - g_Client->ServerDroppedBase) -
+            (hdr->ServerDroppedAttributed.load(std::memory_order_relaxed) - g_Client->ServerDroppedAttributedBase);
+        if (type == PL_DROP_UNATTRIBUTED)
+            return 1;
+    }
+    unsigned firstType = type == PL_DROP_ALL ? 0 : (unsigned)type;
+    unsigned lastType = type == PL_DROP_ALL ? PL_SUB_MAX_TYPE : (unsigned)type;
+    for (unsigned t = firstType; t <= lastType; t++)
+    {
+        if (channel != PL_DROP_ALL)
+            AddDrops(stats, t, (unsigned)channel);
+        else
+            for (unsigned ch = 0; ch < PL_SUB_MAX_CHANNEL; ch++)
+                AddDrops(stats, t, ch);
+    }
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_GetDroppedChannels(int type, int* channels, int nmax)
+{
+    if (!g_Client || type < 0 || type > PL_SUB_MAX_TYPE)
+        return 0;
+    int n = 0;
+    for (int ch = 0; ch < PL_SUB_MAX_CHANNEL; ch++)
+    {
+        const PL_ShmDropCounter& counter = g_Client->Header->ServerDrops[type][ch];
+        if (g_Client->MMFDrops[type][ch] == 0 &&
+            counter.Count.load(std::memory_order_relaxed) == g_Client->ServerDropsBase[type][ch])
+            continue;
+        if (n < nmax)
+            channels[n] = ch;
+        n++;
+    }
+    return n;
+}
+
+
+extern "C" void WINAPI PL_ResetDropStats()
+{
+    if (!g_Client)
+        return;
+    PL_ShmHeader* hdr = g_Client->Header;
+    memset(g_Client->MMFDrops, 0, sizeof(g_Client->MMFDrops));
+    memset(g_Client->MMFDropTimeStamp, 0, sizeof(g_Client->MMFDropTimeStamp));
+    g_Client->MMFDropsUnattributed = 0;
+    for (int type = 0; type <= PL_SUB_MAX_TYPE; type++)
+        for (int ch = 0; ch < PL_SUB_MAX_CHANNEL; ch++)
+            g_Client->ServerDropsBase[type][ch] = hdr->ServerDrops[type][ch].Count.load(std::memory_order_relaxed);
+    g_Client->ServerDroppedBase = hdr->ServerDropped.load(std::memory_order_relaxed);
+    g_Client->ServerDroppedAttributedBase = hdr->ServerDroppedAttributed.load(std::memory_order_relaxed);
+}
+
+
+//
+// "get" commands backed by the configuration snapshot in the segment header.
+// Per-channel arrays receive one entry per DSP channel (NumSpikeChannels,
+// at most PL_CONFIG_MAX_CHANNELS).
+//
+
+// copies one per-DSP-channel array of the configuration
+static void CopyChannelArray(int* dst, const int (PL_ConfigSnapshot::*field)[PL_CONFIG_MAX_CHANNELS])
+{
+    ReadConfig([&](const PL_ConfigSnapshot& config) {
+        int n = config.Info.NumSpikeChannels;
+        if (n > PL_CONFIG_MAX_CHANNELS)
+            n = PL_CONFIG_MAX_CHANNELS;
+        if (n > 0)
+            memcpy(dst, config.*field, n*sizeof(int));
+    });
+}
+
+
+extern "C" int WINAPI PL_GetConfigSnapshot(PL_ConfigSnapshot* config)
+{
+    return ReadConfig([=](const PL_ConfigSnapshot& src) { *config = src; });
+}
+
+
+extern "C" unsigned long long WINAPI PL_GetConfigGeneration()
+{
+    return g_Client ? g_Client->Header->ConfigSeq.load(std::memory_order_acquire)/2 : 0;
+}
+
+
+extern "C" int WINAPI PL_IsLongWaveMode()
+{
+    return ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.LongWaveMode; });
+}
+
+
+extern "C" int WINAPI PL_GetTimeStampTick()
+{
+    return ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.TimeStampTick; });
+}
+
+
+extern "C" int WINAPI PL_GetPollingInterval()
+{
+    return ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.PollingInterval; });
+}
+
+
+extern "C" void WINAPI PL_GetGlobalParsEx(int* numch, int* npw, int* npre, int* gainmult,
+                                          int* maxwflength)
+{
+    PL_ServerInfo info;
+    memset(&info, 0, sizeof(info));
+    ReadConfig([&](const PL_ConfigSnapshot& c) { info = c.Info; });
+    *numch = info.NumSpikeChannels;
+    *npw = info.NPointsWave;
+    *npre = info.NPointsPreThr;
+    *gainmult = info.GainMult;
+    *maxwflength = info.MaxWFLength;
+}
+
+
+extern "C" void WINAPI PL_GetGlobalPars(int* numch, int* npw, int* npre, int* gainmult)
+{
+    int maxwflength;
+    PL_GetGlobalParsEx(numch, npw, npre, gainmult, &maxwflength);
+}
+
+
+extern "C" void WINAPI PL_GetChannelInfo(int* nsig, int* ndsp, int* nout)
+{
+    *nsig = *ndsp = *nout = 0;
+    ReadConfig([=](const PL_ConfigSnapshot& c) {
+        *nsig = c.NumSignals;
+        *ndsp = c.Info.NumSpikeChannels;
+        *nout = c.NumOutputs;
+    });
+}
+
+
+extern "C" void WINAPI PL_GetSIG(int* sig)
+{
+    CopyChannelArray(sig, &PL_ConfigSnapshot::SIG);
+}
+
+
+extern "C" void WINAPI PL_GetFilter(int* filter)
+{
+    CopyChannelArray(filter, &PL_ConfigSnapshot::Filter);
+}
+
+
+extern "C" void WINAPI PL_GetGain(int* gain)
+{
+    CopyChannelArray(gain, &PL_ConfigSnapshot::Gain);
+}
+
+
+extern "C" void WINAPI PL_GetMethod(int* method)
+{
+    CopyChannelArray(method, &PL_ConfigSnapshot::Method);
+}
+
+
+extern "C" void WINAPI PL_GetThreshold(int* thr)
+{
+    CopyChannelArray(thr, &PL_ConfigSnapshot::Threshold);
+}
+
+
+extern "C" void WINAPI PL_GetNumUnits(int* numunits)
+{
+    CopyChannelArray(numunits, &PL_ConfigSnapshot::NumUnits);
+}
+
+
+// ch is the 1-based DSP channel, unit 1 to PL_CONFIG_MAX_UNITS; t receives
+// PL_CONFIG_TEMPLATE_POINTS points
+extern "C" void WINAPI PL_GetTemplate(int ch, int unit, int* t)
+{
+    memset(t, 0, PL_CONFIG_TEMPLATE_POINTS*sizeof(int));
+    if (ch < 1 || ch > PL_CONFIG_MAX_CHANNELS || unit < 1 || unit > PL_CONFIG_MAX_UNITS)
+        return;
+    ReadConfig([=](const PL_ConfigSnapshot& c) {
+        memcpy(t, c.Templates[ch - 1][unit - 1], PL_CONFIG_TEMPLATE_POINTS*sizeof(int));
+    });
+}
+
+
+extern "C" void WINAPI PL_GetNPointsSort(int* npts)
+{
+    *npts = ConfigValue([](const PL_ConfigSnapshot& c) { return c.NPointsSort; });
+}
+
+
+extern "C" void WINAPI PL_GetName(int ch1x, char* name)
+{
+    CopyConfigName(name, &PL_ConfigSnapshot::Names, ch1x - 1);
+}
+
+
+extern "C" void WINAPI PL_GetEventName(int ch1x, char* name)
+{
+    CopyConfigName(name, &PL_ConfigSnapshot::EventNames, ch1x - 1);
+}
+
+
+extern "C" void WINAPI PL_GetSlowChanName(int ch0x, char* name)
+{
+    CopyConfigName(name, &PL_ConfigSnapshot::SlowChanNames, ch0x);
+}
+
+
+// gains receives one entry per continuous channel
+extern "C" void WINAPI PL_GetSlowInfo(int* freq, int* channels, int* gains)
+{
+    *freq = *channels = 0;
+    ReadConfig([=](const PL_ConfigSnapshot& c) {
+        *freq = c.Info.SlowFrequency;
+        *channels = c.Info.NumSlowChannels;
+        int n = c.Info.NumSlowChannels;
+        if (n > PL_CONFIG_MAX_SLOW_CHANNELS)
+            n = PL_CONFIG_MAX_SLOW_CHANNELS;
+        if (gains && n > 0)
+            memcpy(gains, c.SlowGains, n*sizeof(int));
+    });
+}
+
+
+// gains receives 64 entries, 0 past the last continuous channel
+extern "C" void WINAPI PL_GetSlowInfo64(int* freq, int* channels, int* gains)
+{
+    int all[PL_CONFIG_MAX_SLOW_CHANNELS] = { 0 };
+    PL_GetSlowInfo(freq, channels, all);
+    if (gains)
+        memcpy(gains, all, 64*sizeof(int));
+}
+
+
+// freqs and gains receive PL_CONFIG_MAX_SLOW_CHANNELS (256) entries, the
+// sampling rate and gain of each continuous channel, 0 past the last one
+extern "C" void WINAPI PL_GetSlowInfo256(int* freqs, int* channels, int* gains)
+{
+    *channels = 0;
+    if (freqs)
+        memset(freqs, 0, PL_CONFIG_MAX_SLOW_CHANNELS*sizeof(int));
+    if (gains)
+        memset(gains, 0, PL_CONFIG_MAX_SLOW_CHANNELS*sizeof(int));
+    ReadConfig([=](const PL_ConfigSnapshot& c) {
+        *channels = c.Info.NumSlowChannels;
+        int n = c.Info.NumSlowChannels;
+        if (n > PL_CONFIG_MAX_SLOW_CHANNELS)
+            n = PL_CONFIG_MAX_SLOW_CHANNELS;
+        if (freqs && n > 0)
+            memcpy(freqs, c.SlowFrequencies, n*sizeof(int));
+        if (gains && n > 0)
+            memcpy(gains, c.SlowGains, n*sizeof(int));
+    });
+}
+
+
+extern "C" int WINAPI PL_GetNIDAQNumChannels()
+{
+    return ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.NumSlowChannels; });
+}
+
+
+extern "C" int WINAPI PL_IsNIDAQEnabled()
+{
+    return ConfigValue([](const PL_ConfigSnapshot& c) { return c.Info.NumSlowChannels > 0; });
+}
@@ -0,0 +1,264 @@
+//
+//   PlexDispatch.cpp
+//
+//   Dispatch engine of the Linux PlexClient library (PL_AddHandler,
+//   PL_StartDispatch): one reader thread that reads the server with the
+//   ordinary client calls and hands each handler the records that map to it.
+//
+//   Records are routed through a table of handler slots indexed by type,
+//   channel and unit, rebuilt whenever handlers change.  Each read is sorted
+//   by handler with a counting sort (look up every record, count per slot,
+//   place pointers), which involves no per-record branches, and each handler
+//   is then called once with its run of pointers.
+//
+
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+
+#define TABLE_TYPES     (8)                         // types 0 to 7; records of others are skipped
+#define TABLE_CHANNELS  (PL_SUB_MAX_CHANNEL + 1)    // the last column catches channels out of range
+#define TABLE_UNITS     (32)
+
+//
+// handler slot of every type, channel and unit
+//
+struct CTable
+{
+    uint8_t     Slot[TABLE_TYPES][TABLE_CHANNELS][TABLE_UNITS];
+};
+
+
+//
+// one registered handler
+//
+struct CHandler
+{
+    int                 Type;
+    int                 Channel;
+    int                 Unit;
+    PL_RecordHandler    Handler;        // NULL if the slot is free
+    void*               Context;
+    uint64_t            Order;          // registration order, later registrations win
+};
+
+
+//
+// state of the dispatch engine in this process
+//
+struct CDispatch
+{
+    std::mutex          Mutex;          // guards Handlers, Table and Changed
+    CHandler            Handlers[PL_DISPATCH_MAX_HANDLERS + 1];     // slot 0 = no handler
+    uint64_t            NextOrder = 1;
+    CTable              Table;          // built from Handlers
+    bool                Changed = false;
+
+    std::thread         Thread;
+    std::atomic<bool>   Running{false};
+    std::atomic<bool>   Stop{false};
+};
+
+static CDispatch* g_Dispatch = NULL;
+static std::mutex g_DispatchCreate;
+
+
+static CDispatch* Dispatch()
+{
+    std::lock_guard<std::mutex> lock(g_DispatchCreate);
+    if (!g_Dispatch)
+        g_Dispatch = new CDispatch();
+    return g_Dispatch;
+}
+
+
+// rebuilds the table from the registered handlers; called with Mutex held
+static void BuildTable(CDispatch* d)
+{
+    memset(&d->Table, 0, sizeof(d->Table));
+    int order[PL_DISPATCH_MAX_HANDLERS];
+    int n = 0;
+    for (int slot = 1; slot <= PL_DISPATCH_MAX_HANDLERS; slot++)
+        if (d->Handlers[slot].Handler)
+            order[n++] = slot;
+    std::sort(order, order + n, [d](int a, int b) { return d->Handlers[a].Order < d->Handlers[b].Order; });
+
+    for (int i = 0; i < n; i++)
+    {
+        const CHandler& h = d->Handlers[order[i]];
+        for (int type = 0; type < TABLE_TYPES; type++)
+        {
+            if (h.Type != PL_DISPATCH_ANY && h.Type != type)
+                continue;
+            for (int ch = 0; ch < TABLE_CHANNELS; ch++)
+            {
+                if (h.Channel != PL_DISPATCH_ANY && h.Channel != ch)
+                    continue;
+                //** only spikes are told apart by unit; the other types always use unit 0
+                for (int unit = 0; unit < (type == PL_SingleWFType ? TABLE_UNITS : 1); unit++)
+                    if (type != PL_SingleWFType || h.Unit == PL_DISPATCH_ANY || h.Unit == unit)
+                        d->Table.Slot[type][ch][unit] = (uint8_t)order[i];
+            }
+        }
+    }
+    d->Changed = true;
+}
+
+
+static void DispatchThread(CDispatch* d, int maxPerRead)
+{
+    std::vector<PL_WaveLong> records(maxPerRead);
+    std::vector<uint8_t> slots(maxPerRead);
+    std::vector<const PL_WaveLong*> sorted(maxPerRead);
+    CTable* table = new CTable;
+    CHandler handlers[PL_DISPATCH_MAX_HANDLERS + 1];
+    int start[PL_DISPATCH_MAX_HANDLERS + 2];
+
+    //** unit bits kept per type: spikes are told apart by unit, other types are not
+    uint32_t unitMask[TABLE_TYPES] = { 0 };
+    unitMask[PL_SingleWFType] = TABLE_UNITS - 1;
+
+    int interval = PL_GetPollingInterval();
+    if (interval <= 0)
+        interval = 10;
+
+    {
+        std::lock_guard<std::mutex> lock(d->Mutex);
+        *table = d->Table;
+        memcpy(handlers, d->Handlers, sizeof(handlers));
+        d->Changed = false;
+    }
+
+    while (!d->Stop.load(std::memory_order_relaxed))
+    {
+        if (PL_WaitForData(1, interval*1000) < 0)
+            break;
+        int n = maxPerRead;
+        int serverDropped, mmfDropped, pollHigh, pollLow;
+        PL_GetLongWaveFormStructuresEx2(&n, records.data(), &serverDropped, &mmfDropped,
+                                        &pollHigh, &pollLow);
+        if (n <= 0)
+            continue;
+
+        //** handler changes apply from this read on
+        {
+            std::lock_guard<std::mutex> lock(d->Mutex);
+            if (d->Changed)
+            {
+                *table = d->Table;
+                memcpy(handlers, d->Handlers, sizeof(handlers));
+                d->Changed = false;
+            }
+        }
+
+        //** look up and count
+        int count[PL_DISPATCH_MAX_HANDLERS + 1] = { 0 };
+        for (int i = 0; i < n; i++)
+        {
+            const PL_WaveLong& rec = records[i];
+            uint32_t type = (uint32_t)(unsigned char)rec.Type;
+            uint32_t ch = (uint32_t)(unsigned short)rec.Channel;
+            ch = ch < PL_SUB_MAX_CHANNEL ? ch : PL_SUB_MAX_CHANNEL;
+            uint8_t slot = 0;   //** types no handler can name are skipped
+            if (type < TABLE_TYPES)
+                slot = table->Slot[type][ch][(uint32_t)(unsigned short)rec.Unit & unitMask[type]];
+            slots[i] = slot;
+            count[slot]++;
+        }
+
+        //** place, keeping stream order within each handler
+        start[0] = 0;
+        for (int slot = 0; slot <= PL_DISPATCH_MAX_HANDLERS; slot++)
+            start[slot + 1] = start[slot] + count[slot];
+        int next[PL_DISPATCH_MAX_HANDLERS + 1];
+        memcpy(next, start, sizeof(next));
+        for (int i = 0; i < n; i++)
+            sorted[next[slots[i]]++] = &records[i];
+
+        //** slot 0 collects the records no handler wants
+        for (int slot = 1; slot <= PL_DISPATCH_MAX_HANDLERS; slot++)
+            if (count[slot] > 0 && handlers[slot].Handler)
+                handlers[slot].Handler(sorted.data() + start[slot], count[slot], handlers[slot].Context);
+    }
+
+    delete table;
+    d->Running.store(false);
+}
+
+
+extern "C" int WINAPI PL_AddHandler(int type, int channel, int unit,
+                                    PL_RecordHandler handler, void* context)
+{
+    if (!handler || type < PL_DISPATCH_ANY || type >= TABLE_TYPES ||
+        channel < PL_DISPATCH_ANY || channel >= PL_SUB_MAX_CHANNEL ||
+        unit < PL_DISPATCH_ANY || unit >= TABLE_UNITS)
+        return 0;
+
+    CDispatch* d = Dispatch();
+    std::lock_guard<std::mutex> lock(d->Mutex);
+    for (int slot = 1; slot <= PL_DISPATCH_MAX_HANDLERS; slot++)
+    {
+        CHandler& h = d->Handlers[slot];
+        if (h.Handler)
+            continue;
+        h.Type = type;
+        h.Channel = channel;
+        h.Unit = unit;
+        h.Handler = handler;
+        h.Context = context;
+        h.Order = d->NextOrder++;
+        BuildTable(d);
+        return slot;
+    }
+    return 0;
+}
+
+
+extern "C" int WINAPI PL_RemoveHandler(int id)
+{
+    if (id < 1 || id > PL_DISPATCH_MAX_HANDLERS)
+        return 0;
+    CDispatch* d = Dispatch();
+    std::lock_guard<std::mutex> lock(d->Mutex);
+    if (!d->Handlers[id].Handler)
+        return 0;
+    d->Handlers[id].Handler = NULL;
+    BuildTable(d);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_StartDispatch(int maxPerRead)
+{
+    if (PL_WaitForData(1, 0) < 0)
+        return 0; //** not connected
+    CDispatch* d = Dispatch();
+    if (d->Running.load())
+        return 1;
+    if (d->Thread.joinable())
+        d->Thread.join();   //** finished on its own, e.g. the server closed
+    if (maxPerRead <= 0)
+        maxPerRead = 65536;
+    d->Stop.store(false);
+    d->Running.store(true);
+    d->Thread = std::thread(DispatchThread, d, maxPerRead);
+    return 1;
+}
+
+
+extern "C" void WINAPI PL_StopDispatch()
+{
+    if (!g_Dispatch)
+        return;
+    g_Dispatch->Stop.store(true);
+    if (g_Dispatch->Thread.joinable())
+        g_Dispatch->Thread.join();
+}
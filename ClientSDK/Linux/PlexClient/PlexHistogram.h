@@ -0,0 +1,88 @@
+//
+//   PlexHistogram.h
+//
+//   Log-linear (HDR-style) histogram of nanosecond durations, used by the
+//   client library's latency statistics.  Values below 64 ns have their own
+//   bucket; above that, every power of two is split into 32 buckets, so a
+//   bucket is never wider than about 3% of its values.  Recording is a few
+//   instructions and never allocates.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+
+#define PL_HIST_SUB_BITS    (5)
+#define PL_HIST_SUB_COUNT   (1 << PL_HIST_SUB_BITS)     // buckets per power of two
+#define PL_HIST_MAX_BITS    (40)                        // values up to 2^40 ns (~18 minutes)
+#define PL_HIST_BUCKETS     (2*PL_HIST_SUB_COUNT + (PL_HIST_MAX_BITS - PL_HIST_SUB_BITS - 1)*PL_HIST_SUB_COUNT)
+
+
+struct CHistogram
+{
+    uint64_t    Counts[PL_HIST_BUCKETS];
+    uint64_t    Total;
+    uint64_t    Min;
+    uint64_t    Max;
+    double      Sum;
+
+    void Reset()
+    {
+        memset(this, 0, sizeof(*this));
+    }
+
+    void Record(uint64_t value)
+    {
+        if (Total == 0 || value < Min)
+            Min = value;
+        if (value > Max)
+            Max = value;
+        Total++;
+        Sum += (double)value;
+        Counts[Bucket(value)]++;
+    }
+
+    // smallest value that falls in bucket i
+    static uint64_t LowerBound(int i)
+    {
+        if (i < 2*PL_HIST_SUB_COUNT)
+            return (uint64_t)i;
+        int shift = (i - 2*PL_HIST_SUB_COUNT)/PL_HIST_SUB_COUNT + 1;
+        uint64_t mantissa = (uint64_t)(i % PL_HIST_SUB_COUNT + PL_HIST_SUB_COUNT);
+        return mantissa << shift;
+    }
+
+    static int Bucket(uint64_t value)
+    {
+        if (value < 2*PL_HIST_SUB_COUNT)
+            return (int)value;
+        int msb = 63 - __builtin_clzll(value);
+        if (msb >= PL_HIST_MAX_BITS)
+            return PL_HIST_BUCKETS - 1;
+        int shift = msb - PL_HIST_SUB_BITS;
+        return 2*PL_HIST_SUB_COUNT + (shift - 1)*PL_HIST_SUB_COUNT +
+               (int)((value >> shift) - PL_HIST_SUB_COUNT);
+    }
+
+    // value at or below which the given percentage of the recorded values
+    // lie, reported as the upper end of its bucket (never above Max)
+    uint64_t Percentile(double percent) const
+    {
+        if (Total == 0)
+            return 0;
+        double rank = percent/100.0*(double)Total;
+        uint64_t seen = 0;
+        for (int i = 0; i < PL_HIST_BUCKETS; i++)
+        {
+            seen += Counts[i];
+            if (seen > 0 && (double)seen >= rank)
+            {
+                uint64_t upper = i + 1 < PL_HIST_BUCKETS ? LowerBound(i + 1) - 1 : Max;
+                return upper < Max ? upper : Max;
+            }
+        }
+        return Max;
+    }
+};
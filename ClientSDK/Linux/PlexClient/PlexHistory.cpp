@@ -0,0 +1,386 @@
+//
+//   PlexHistory.cpp
+//
+//   History store of the Linux PlexClient library: the last seconds of every
+//   continuous channel in a shared-memory segment of its own, filled by one
+//   process and read by any number of others.  See PlexonShm.h.
+//
+//   Each ring has a single writer and is validated exactly like the record
+//   ring (see PlexShm.h): readers copy samples below Count and then discard
+//   those below Claim - Depth, which may have been overwritten.  Samples are
+//   stored at the slot of their timestamp, so a time window maps to a range
+//   of slots with two divisions.
+//
+
+#include "PlexShm.h"
+
+#include <fcntl.h>
+#include <new>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//
+// history store open in this process
+//
+struct CHistory
+{
+    char                    Name[256];
+    size_t                  Size;
+    PL_ShmHistoryHeader*    Header;
+    PL_ShmHistoryRing*      Rings;
+    short*                  Samples;
+    bool                    Owner;      // created by this process, which fills it
+};
+
+static CHistory* g_History = NULL;
+
+// copies are retried this many times before returning the intact part
+#define HISTORY_READ_TRIES  (4)
+
+// samples kept per channel at most
+#define HISTORY_MAX_DEPTH   (1u << 28)
+
+
+static const char* HistoryName(const char* name)
+{
+    return name && *name ? name : PL_HISTORY_DEFAULT_NAME;
+}
+
+
+// index of the slot nearest to dt ticks after the origin
+static inline uint64_t SlotAt(const PL_ShmHistoryRing& ring, uint64_t dt)
+{
+    return (2*dt*ring.Frequency + ring.TickRate)/(2*(uint64_t)ring.TickRate);
+}
+
+
+// ticks from the origin to slot i, rounded to the nearest tick
+static inline uint64_t SlotTime(const PL_ShmHistoryRing& ring, uint64_t i)
+{
+    return (2*i*ring.TickRate + ring.Frequency)/(2*(uint64_t)ring.Frequency);
+}
+
+
+// first slot whose time is at least dt ticks after the origin
+static inline uint64_t FirstSlotFrom(const PL_ShmHistoryRing& ring, uint64_t dt)
+{
+    if (dt == 0)
+        return 0;
+    uint64_t den = 2*(uint64_t)ring.TickRate;
+    return ((2*dt - 1)*ring.Frequency + den - 1)/den;
+}
+
+
+static void OpenHistory(const char* name, void* p, size_t size, bool owner)
+{
+    g_History = new CHistory();
+    snprintf(g_History->Name, sizeof(g_History->Name), "%s", name);
+    g_History->Size = size;
+    g_History->Header = (PL_ShmHistoryHeader*)p;
+    g_History->Rings = PL_ShmHistoryRings(g_History->Header);
+    g_History->Samples = PL_ShmHistorySamples(g_History->Header);
+    g_History->Owner = owner;
+}
+
+
+extern "C" int WINAPI PL_CreateHistoryStore(const char* name, int channels, int seconds,
+                                            const int* freqs, int tick)
+{
+    if (g_History || channels <= 0 || channels > PL_CONFIG_MAX_SLOW_CHANNELS ||
+        seconds < 0 || seconds > 3600)
+        return 0;
+    if (seconds == 0)
+        seconds = PL_HISTORY_DEFAULT_SECONDS;
+    if (tick <= 0)
+        tick = PL_GetTimeStampTick();
+    int slowFreqs[PL_CONFIG_MAX_SLOW_CHANNELS];
+    if (!freqs)
+    {
+        int slowChannels;
+        PL_GetSlowInfo256(slowFreqs, &slowChannels, NULL);
+        if (slowChannels <= 0)
+            return 0;
+        freqs = slowFreqs;
+    }
+    //** slots are placed at exact fractions of a second, counted in ticks
+    if (tick <= 0 || 1000000 % tick != 0)
+        return 0;
+    uint32_t tickRate = (uint32_t)(1000000/tick);
+
+    //** ring sizes first: channels at a rate of 0 keep nothing
+    uint32_t depth[PL_CONFIG_MAX_SLOW_CHANNELS];
+    uint64_t samples = 0;
+    for (int ch = 0; ch < channels; ch++)
+    {
+        int freq = freqs[ch];
+        depth[ch] = 0;
+        if (freq <= 0)
+            continue;
+        uint64_t want = (uint64_t)seconds*(uint64_t)freq;
+        uint32_t size2 = 2;
+        while (size2 < want && size2 < HISTORY_MAX_DEPTH)
+            size2 *= 2;
+        depth[ch] = size2;
+        samples += size2;
+    }
+
+    name = HistoryName(name);
+    size_t size = PL_ShmHistorySize((uint32_t)channels, samples);
+
+    //** a stale segment left by a process that died is replaced, a live one is left alone
+    if (!PL_ShmUnlinkStale(name, offsetof(PL_ShmHistoryHeader, OwnerPid)))
+    {
+        fprintf(stderr, "PL_CreateHistoryStore: %s is in use by a running process\n", name);
+        return 0;
+    }
+    int fd = PL_ShmCreate(name);
+    if (fd < 0)
+    {
+        perror("PL_CreateHistoryStore: shm_open");
+        return 0;
+    }
+    fchmod(fd, 0666); //** not subject to umask, so analyses of other users can read it
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        perror("PL_CreateHistoryStore: ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        perror("PL_CreateHistoryStore: mmap");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    //** the segment is zero-filled, so every ring starts empty
+    PL_ShmHistoryHeader* hdr = new (p) PL_ShmHistoryHeader();
+    hdr->Version = PL_HISTORY_VERSION;
+    hdr->Channels = (uint32_t)channels;
+    hdr->OwnerPid = getpid();
+    close(fd);
+    PL_ShmHistoryRing* rings = PL_ShmHistoryRings(hdr);
+    uint64_t offset = 0;
+    for (int ch = 0; ch < channels; ch++)
+    {
+        PL_ShmHistoryRing* ring = new (rings + ch) PL_ShmHistoryRing();
+        ring->Offset = offset;
+        ring->Depth = depth[ch];
+        ring->Frequency = depth[ch] ? (uint32_t)freqs[ch] : 0;
+        ring->TickRate = tickRate;
+        offset += depth[ch];
+    }
+
+    //** the magic number goes in last: readers refuse a segment without it
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->Magic = PL_HISTORY_MAGIC;
+
+    OpenHistory(name, p, size, true);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_PutHistory(const PL_WaveLong* records, int n)
+{
+    if (!g_History || !g_History->Owner || !records)
+        return 0;
+    uint32_t channels = g_History->Header->Channels;
+    int stored = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const PL_WaveLong& rec = records[i];
+        uint32_t ch = (uint32_t)rec.Channel;
+        if (rec.Type != PL_ADDataType || ch >= channels)
+            continue;
+        PL_ShmHistoryRing& ring = g_History->Rings[ch];
+        uint64_t depth = ring.Depth;
+        int words = rec.NumberOfDataWords;
+        if (depth == 0 || words <= 0)
+            continue;
+        if (words > MAX_WF_LENGTH_LONG)
+            words = MAX_WF_LENGTH_LONG;
+
+        //** the first sample of the channel fixes the time of every slot
+        uint64_t ts = PL_ShmTimeStamp(rec);
+        uint64_t count = ring.Count.load(std::memory_order_relaxed);
+        uint64_t origin;
+        if (count == 0)
+        {
+            origin = ts;
+            ring.Origin.store(origin, std::memory_order_relaxed);
+        }
+        else
+            origin = ring.Origin.load(std::memory_order_relaxed);
+        if (ts < origin)
+            continue;
+        uint64_t first = SlotAt(ring, ts - origin);
+        uint64_t end = first + (uint64_t)words;
+        if (end <= count)
+        {
+            ring.Missing.fetch_add((uint64_t)words, std::memory_order_relaxed);
+            continue;
+        }
+
+        //** samples already stored are kept, and the ones of this block that
+        //** would replace them are counted as missing; a gap before the block
+        //** is zeroed, as far as the ring reaches
+        uint64_t start = first > count ? first : count;
+        uint64_t zeroFrom = start - count > depth ? start - depth : count;
+        ring.Claim.store(end, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        short* base = g_History->Samples + ring.Offset;
+        for (uint64_t k = zeroFrom; k < start; k++)
+            base[k & (depth - 1)] = 0;
+        for (uint64_t k = start; k < end; k++)
+            base[k & (depth - 1)] = rec.WaveForm[k - first];
+        if (start > count)
+            ring.Missing.fetch_add(start - count, std::memory_order_relaxed);
+        else if (start > first)
+            ring.Missing.fetch_add(start - first, std::memory_order_relaxed);
+        ring.Count.store(end, std::memory_order_release);
+        stored += (int)(end - start);
+    }
+    return stored;
+}
+
+
+extern "C" int WINAPI PL_OpenHistoryStore(const char* name)
+{
+    if (g_History)
+        return 0;
+    name = HistoryName(name);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PL_ShmHistoryRing))
+    {
+        close(fd);
+        return 0;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+
+    PL_ShmHistoryHeader* hdr = (PL_ShmHistoryHeader*)p;
+    bool valid = hdr->Magic == PL_HISTORY_MAGIC && hdr->Version == PL_HISTORY_VERSION &&
+                 PL_ShmHistorySize(hdr->Channels, 0) <= (size_t)st.st_size;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    for (uint32_t ch = 0; valid && ch < hdr->Channels; ch++)
+    {
+        const PL_ShmHistoryRing& ring = PL_ShmHistoryRings(hdr)[ch];
+        valid = (ring.Depth & (ring.Depth - 1)) == 0 &&
+                (ring.Depth == 0 || (ring.Frequency > 0 && ring.TickRate > 0)) &&
+                PL_ShmHistorySize(hdr->Channels, ring.Offset + ring.Depth) <= (size_t)st.st_size;
+    }
+    if (!valid)
+    {
+        munmap(p, (size_t)st.st_size);
+        return 0;
+    }
+
+    OpenHistory(name, p, (size_t)st.st_size, false);
+    return 1;
+}
+
+
+static const PL_ShmHistoryRing* HistoryRing(int channel)
+{
+    if (!g_History || channel < 0 || (uint32_t)channel >= g_History->Header->Channels)
+        return NULL;
+    const PL_ShmHistoryRing* ring = g_History->Rings + channel;
+    return ring->Depth ? ring : NULL;
+}
+
+
+extern "C" int WINAPI PL_GetHistoryRange(int channel, unsigned long long* first,
+                                         unsigned long long* end, double* ticks,
+                                         unsigned long long* missing)
+{
+    const PL_ShmHistoryRing* ring = HistoryRing(channel);
+    uint64_t count = ring ? ring->Count.load(std::memory_order_acquire) : 0;
+    uint64_t origin = count ? ring->Origin.load(std::memory_order_relaxed) : 0;
+    uint64_t oldest = ring && count > ring->Depth ? count - ring->Depth : 0;
+    if (first)
+        *first = count ? origin + SlotTime(*ring, oldest) : 0;
+    if (end)
+        *end = count ? origin + SlotTime(*ring, count) : 0;
+    if (ticks)
+        *ticks = ring ? (double)ring->TickRate/ring->Frequency : 0.0;
+    if (missing)
+        *missing = ring ? ring->Missing.load(std::memory_order_relaxed) : 0;
+    return count > 0;
+}
+
+
+extern "C" int WINAPI PL_GetHistory(int channel, unsigned long long t0, unsigned long long t1,
+                                    int nmax, short* samples, unsigned long long* first)
+{
+    if (first)
+        *first = 0;
+    const PL_ShmHistoryRing* ring = HistoryRing(channel);
+    if (!ring || !samples || nmax <= 0 || t1 <= t0)
+        return 0;
+    const short* base = g_History->Samples + ring->Offset;
+    uint64_t depth = ring->Depth;
+
+    uint64_t origin = 0, lo = 0, copied = 0, lost = 0;
+    for (int tries = 0; tries < HISTORY_READ_TRIES; tries++)
+    {
+        uint64_t count = ring->Count.load(std::memory_order_acquire);
+        if (count == 0)
+            return 0;
+        origin = ring->Origin.load(std::memory_order_relaxed);
+
+        //** the window is the slots [lo, hi) whose times fall in [t0, t1)
+        lo = t0 > origin ? FirstSlotFrom(*ring, t0 - origin) : 0;
+        uint64_t hi = t1 > origin ? FirstSlotFrom(*ring, t1 - origin) : 0;
+        if (hi > count)
+            hi = count;
+        if (count > depth && lo < count - depth)
+            lo = count - depth;
+        copied = hi > lo ? hi - lo : 0;
+        if (copied > (uint64_t)nmax)
+            copied = (uint64_t)nmax;
+        uint64_t slot = lo & (depth - 1);
+        uint64_t part = depth - slot < copied ? depth - slot : copied;
+        memcpy(samples, base + slot, (size_t)part*sizeof(short));
+        memcpy(samples + part, base, (size_t)(copied - part)*sizeof(short));
+
+        //** samples below Claim - Depth may have been overwritten while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t claim = ring->Claim.load(std::memory_order_relaxed);
+        uint64_t valid = claim > depth ? claim - depth : 0;
+        lost = valid > lo ? valid - lo : 0;
+        if (lost == 0 || copied == 0)
+            break;
+    }
+    if (lost > copied)
+        lost = copied;
+    if (lost)
+        memmove(samples, samples + lost, (size_t)(copied - lost)*sizeof(short));
+    if (first && copied > lost)
+        *first = origin + SlotTime(*ring, lo + lost);
+    return (int)(copied - lost);
+}
+
+
+extern "C" void WINAPI PL_CloseHistoryStore()
+{
+    if (!g_History)
+        return;
+    munmap(g_History->Header, g_History->Size);
+    if (g_History->Owner)
+        shm_unlink(g_History->Name);
+    delete g_History;
+    g_History = NULL;
+}
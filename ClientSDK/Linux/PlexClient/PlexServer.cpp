@@ -0,0 +1,550 @@
+//
+//   PlexServer.cpp
+//
+//   Server side of the Linux shared-memory ring: creates the segment and
+//   publishes PL_WaveLong records to all connected clients.  See PlexServer.h.
+//
+//   PL_ServerPutRecords must only be called from one thread at a time; the
+//   ring has a single writer.
+//
+
+#include "PlexShm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <new>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+
+//
+// state of the server in this process
+//
+struct CServerLane
+{
+    PL_WaveLong*    Records;
+    uint64_t        Mask;
+    uint64_t*       Shadow;
+    uint64_t        ShadowMask;
+};
+
+struct CServer
+{
+    char            Name[256];
+    size_t          Size;
+    PL_ShmHeader*   Header;
+    CServerLane     Lanes[PL_SHM_LANES];
+    bool            Continuous;     // PL_ADDataType records go to their own lane
+    bool            ClockSampled;   // PL_ServerClockSample has been called
+};
+
+static CServer* g_Server = NULL;
+
+
+// wakes the clients waiting in PL_WaitForData one of whose wake indexes has
+// been reached by the lanes' write indexes w (all clients if w is NULL)
+static void WakeClients(const uint64_t* w)
+{
+    PL_ShmHeader* hdr = g_Server->Header;
+    uint64_t reached[PL_SHM_LANES + 1];
+    reached[PL_SHM_WAKE_TOTAL] = 0;
+    for (int lane = 0; lane < PL_SHM_LANES; lane++)
+    {
+        reached[lane] = w ? w[lane] : PL_WAKE_NEVER;
+        reached[PL_SHM_WAKE_TOTAL] = w ? reached[PL_SHM_WAKE_TOTAL] + w[lane] : PL_WAKE_NEVER;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (int i = 0; i < PL_SERVER_MAX_CLIENTS; i++)
+    {
+        PL_ShmCursor* cursor = hdr->Cursors + i;
+        bool wake = false;
+        for (int k = 0; k <= PL_SHM_LANES; k++)
+            wake |= cursor->WakeAt[k].load(std::memory_order_relaxed) <= reached[k];
+        if (wake)
+        {
+            cursor->WakeSeq.fetch_add(1, std::memory_order_release);
+            PL_ShmFutexWake(&cursor->WakeSeq);
+        }
+    }
+}
+
+
+// an id that differs between server runs, across reboots too
+static uint64_t NewSession()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ((uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec) ^ ((uint64_t)getpid() << 40);
+}
+
+
+// default configuration for the given server parameters
+static void InitConfig(PL_ConfigSnapshot* config, const PL_ServerInfo& info)
+{
+    memset(config, 0, sizeof(*config));
+    config->Info = info;
+    config->NumSignals = info.NumSpikeChannels;
+    config->NPointsSort = info.NPointsWave;
+    for (int ch = 0; ch < PL_CONFIG_MAX_CHANNELS; ch++)
+    {
+        config->SIG[ch] = ch + 1;
+        config->Gain[ch] = 1;
+        snprintf(config->Names[ch], PL_CONFIG_NAME_LENGTH, "sig%03d", ch + 1);
+    }
+    for (int ch = 0; ch < PL_CONFIG_MAX_EVENT_CHANNELS; ch++)
+        snprintf(config->EventNames[ch], PL_CONFIG_NAME_LENGTH, "Event%03d", ch + 1);
+    for (int ch = 0; ch < PL_CONFIG_MAX_SLOW_CHANNELS; ch++)
+    {
+        config->SlowGains[ch] = 1;
+        config->SlowFrequencies[ch] = info.SlowFrequency;
+        snprintf(config->SlowChanNames[ch], PL_CONFIG_NAME_LENGTH, "AD%02d", ch);
+    }
+}
+
+
+// replaces the configuration under the seqlock; returns the new generation
+static uint64_t WriteConfig(PL_ShmHeader* hdr, const PL_ConfigSnapshot& config)
+{
+    uint64_t seq = hdr->ConfigSeq.load(std::memory_order_relaxed);
+    hdr->ConfigSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&hdr->Config, &config, sizeof(config));
+    hdr->Config.Generation = (seq + 2)/2;
+    hdr->ConfigSeq.store(seq + 2, std::memory_order_release);
+    return (seq + 2)/2;
+}
+
+
+// appends a clock sample under the seqlock
+static void AddClockSample(PL_ShmHeader* hdr, uint64_t ts, uint64_t hostNanos)
+{
+    uint64_t seq = hdr->ClockSeq.load(std::memory_order_relaxed);
+    uint64_t count = hdr->ClockCount.load(std::memory_order_relaxed);
+    hdr->ClockSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    PL_ShmClockSample& sample = hdr->Clock[count % PL_SHM_CLOCK_SAMPLES];
+    sample.TimeStamp = ts;
+    sample.HostNanos = hostNanos;
+    hdr->ClockCount.store(count + 1, std::memory_order_relaxed);
+    hdr->ClockSeq.store(seq + 2, std::memory_order_release);
+}
+
+
+extern "C" void WINAPI PL_ServerInitInfo(PL_ServerInfo* info)
+{
+    memset(info, 0, sizeof(*info));
+    info->TimeStampTick = 25;
+    info->PollingInterval = 10;
+    info->LongWaveMode = 1;
+    info->NumSpikeChannels = 16;
+    info->NPointsWave = 32;
+    info->NPointsPreThr = 8;
+    info->GainMult = 1;
+    info->MaxWFLength = MAX_WF_LENGTH_LONG;
+    info->NumSlowChannels = 0;
+    info->SlowFrequency = 1000;
+}
+
+
+extern "C" int WINAPI PL_ServerCreate(const char* name, int capacity, const PL_ServerInfo* info)
+{
+    return PL_ServerCreateEx(name, capacity, 0, info);
+}
+
+
+extern "C" int WINAPI PL_ServerCreateEx(const char* name, int capacity, int continuousCapacity,
+                                        const PL_ServerInfo* info)
+{
+    if (g_Server)
+        return 0;
+    if (capacity == 0)
+        capacity = PL_SERVER_DEFAULT_CAPACITY;
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+        return 0;
+    if (continuousCapacity < 0 || continuousCapacity == 1 ||
+        (continuousCapacity & (continuousCapacity - 1)) != 0)
+        return 0;
+
+    name = PL_ShmName(name);
+    size_t size = PL_ShmSize((uint32_t)capacity, (uint32_t)continuousCapacity);
+
+    //** a stale segment from a previous server run is replaced, clients still
+    //** mapping it keep their pages until they reconnect; a live one is left alone
+    if (!PL_ShmUnlinkStale(name, offsetof(PL_ShmHeader, ServerPid)))
+    {
+        fprintf(stderr, "PL_ServerCreate: %s is in use by a running server\n", name);
+        return 0;
+    }
+    int fd = PL_ShmCreate(name);
+    if (fd < 0)
+    {
+        perror("PL_ServerCreate: shm_open");
+        return 0;
+    }
+    fchmod(fd, 0666); //** not subject to umask, so clients of other users can connect
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        perror("PL_ServerCreate: ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        perror("PL_ServerCreate: mmap");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    PL_ShmHeader* hdr = new (p) PL_ShmHeader();
+    hdr->Version = PL_SHM_VERSION;
+    hdr->HeaderSize = (uint32_t)PL_ShmHeaderSize();
+    hdr->RecordSize = sizeof(PL_WaveLong);
+    hdr->ServerPid = getpid();
+    close(fd); //** the pid is stored: release the lock taken by PL_ShmCreate
+    hdr->Session = NewSession();
+    PL_ServerInfo defaults;
+    if (!info)
+    {
+        PL_ServerInitInfo(&defaults);
+        info = &defaults;
+    }
+    PL_ConfigSnapshot* config = new PL_ConfigSnapshot;
+    InitConfig(config, *info);
+    WriteConfig(hdr, *config);
+    delete config;
+    uint32_t capacities[PL_SHM_LANES] = { (uint32_t)capacity, (uint32_t)continuousCapacity };
+    uint64_t offset = hdr->HeaderSize;
+    for (int lane = 0; lane < PL_SHM_LANES; lane++)
+    {
+        PL_ShmLane& l = hdr->Lanes[lane];
+        l.WriteClaim.store(0, std::memory_order_relaxed);
+        l.WriteIndex.store(0, std::memory_order_relaxed);
+        l.Capacity = capacities[lane];
+        l.RecordsOffset = offset;
+        l.ShadowOffset = offset + (uint64_t)l.Capacity*sizeof(PL_WaveLong);
+        offset += PL_ShmLaneSize(l.Capacity);
+    }
+    hdr->PublishSeq.store(0, std::memory_order_relaxed);
+    hdr->PollTime.store(PL_ShmNow(), std::memory_order_relaxed);
+    hdr->ServerDropped.store(0, std::memory_order_relaxed);
+    hdr->Closed.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < PL_SERVER_MAX_CLIENTS; i++)
+        for (int k = 0; k <= PL_SHM_LANES; k++)
+            hdr->Cursors[i].WakeAt[k].store(PL_WAKE_NEVER, std::memory_order_relaxed);
+
+    //** the magic number goes in last: clients refuse a segment without it
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->Magic = PL_SHM_MAGIC;
+
+    g_Server = new CServer();
+    snprintf(g_Server->Name, sizeof(g_Server->Name), "%s", name);
+    g_Server->Size = size;
+    g_Server->Header = hdr;
+    for (int lane = 0; lane < PL_SHM_LANES; lane++)
+    {
+        CServerLane& l = g_Server->Lanes[lane];
+        l.Records = PL_ShmRecords(hdr, lane);
+        l.Mask = (uint64_t)capacities[lane] - 1;
+        l.Shadow = PL_ShmShadow(hdr, lane);
+        l.ShadowMask = (uint64_t)capacities[lane]*PL_SHM_SHADOW_FACTOR - 1;
+    }
+    g_Server->Continuous = continuousCapacity > 0;
+    return 1;
+}
+
+
+// true if the record belongs in the continuous lane
+static inline bool IsContinuous(const PL_WaveLong& rec)
+{
+    return g_Server->Continuous && rec.Type == PL_ADDataType;
+}
+
+
+// Copies the count records of one lane among records[0, n) into the lane
+// and returns its new write index, without publishing them.  Records that
+// would be overwritten again within this call are skipped.
+static uint64_t WriteLane(int lane, const PL_WaveLong* records, int n, uint64_t count)
+{
+    PL_ShmLane& shm = g_Server->Header->Lanes[lane];
+    CServerLane& l = g_Server->Lanes[lane];
+    uint64_t capacity = l.Mask + 1;
+    uint64_t shadowCapacity = l.ShadowMask + 1;
+    uint64_t w = shm.WriteIndex.load(std::memory_order_relaxed);
+    uint64_t end = w + count;
+    if (count == 0)
+        return end;
+
+    //** announce the slots about to be overwritten before touching them
+    shm.WriteClaim.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (count == (uint64_t)n)
+    {
+        uint64_t i = count > capacity ? end - capacity : w;
+        while (i < end)
+        {
+            uint64_t slot = i & l.Mask;
+            uint64_t run = end - i;
+            if (run > capacity - slot)
+                run = capacity - slot;
+            memcpy(l.Records + slot, records + (i - w), run*sizeof(PL_WaveLong));
+            i += run;
+        }
+    }
+    else
+    {
+        uint64_t i = w;
+        for (int k = 0; k < n; k++)
+        {
+            if (IsContinuous(records[k]) != (lane == PL_SHM_LANE_CONTINUOUS))
+                continue;
+            if (i + capacity >= end)
+                l.Records[i & l.Mask] = records[k];
+            i++;
+        }
+    }
+
+    //** the shadow ring keeps the type and channel of every record for longer
+    uint64_t i = w;
+    for (int k = 0; k < n && i < end; k++)
+    {
+        if (count != (uint64_t)n && IsContinuous(records[k]) != (lane == PL_SHM_LANE_CONTINUOUS))
+            continue;
+        if (i + shadowCapacity >= end)
+            l.Shadow[i & l.ShadowMask] = PL_ShmShadowEntry(records[k]);
+        i++;
+    }
+    return end;
+}
+
+
+extern "C" int WINAPI PL_ServerPutRecords(const PL_WaveLong* records, int n)
+{
+    if (!g_Server || !records || n <= 0)
+        return 0;
+
+    PL_ShmHeader* hdr = g_Server->Header;
+    uint64_t continuous = 0;
+    if (g_Server->Continuous)
+        for (int k = 0; k < n; k++)
+            continuous += IsContinuous(records[k]);
+
+    //** the continuous lane is filled first, so that a client that sees the
+    //** events of this publish also sees its continuous data
+    uint64_t end[PL_SHM_LANES];
+    end[PL_SHM_LANE_CONTINUOUS] = WriteLane(PL_SHM_LANE_CONTINUOUS, records, n, continuous);
+    end[PL_SHM_LANE_EVENTS] = WriteLane(PL_SHM_LANE_EVENTS, records, n, (uint64_t)n - continuous);
+
+    uint64_t now = PL_ShmNow();
+    if (!g_Server->ClockSampled)
+        AddClockSample(hdr, PL_ShmTimeStamp(records[n - 1]), now);
+    hdr->PollTime.store(now, std::memory_order_relaxed);
+
+    uint64_t seq = hdr->PublishSeq.load(std::memory_order_relaxed);
+    hdr->PublishSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->Lanes[PL_SHM_LANE_CONTINUOUS].WriteIndex.store(end[PL_SHM_LANE_CONTINUOUS], std::memory_order_release);
+    hdr->Lanes[PL_SHM_LANE_EVENTS].WriteIndex.store(end[PL_SHM_LANE_EVENTS], std::memory_order_release);
+    hdr->PublishSeq.store(seq + 2, std::memory_order_release);
+    WakeClients(end);
+    return n;
+}
+
+
+extern "C" void WINAPI PL_ServerClockSample(unsigned long long ts, unsigned long long hostNanos)
+{
+    if (!g_Server)
+        return;
+    g_Server->ClockSampled = true;
+    AddClockSample(g_Server->Header, ts, hostNanos ? hostNanos : PL_ShmNow());
+}
+
+
+extern "C" void WINAPI PL_ServerAddDropped(int n)
+{
+    if (g_Server && n > 0)
+        g_Server->Header->ServerDropped.fetch_add((uint64_t)n, std::memory_order_relaxed);
+}
+
+
+extern "C" int WINAPI PL_ServerTakeUserEvents(PL_WaveLong* records, int nmax,
+                                              unsigned long long first, unsigned long long last)
+{
+    //** every batch must fit, or one too large would block the queue for good
+    if (!g_Server || !records || nmax < PL_USER_EVENT_MAX_BATCH)
+        return 0;
+
+    //** ready batches, oldest ticket first
+    PL_ShmHeader* hdr = g_Server->Header;
+    PL_ShmUserBatch* ready[PL_SHM_USER_BATCHES];
+    int numReady = 0;
+    for (int i = 0; i < PL_SHM_USER_BATCHES; i++)
+    {
+        PL_ShmUserBatch* batch = hdr->UserBatches + i;
+        uint32_t state = batch->State.load(std::memory_order_acquire);
+        if (state == PL_USER_BATCH_READY)
+            ready[numReady++] = batch;
+        else if ((state & 3) == PL_USER_BATCH_FILLING && kill((pid_t)(state >> 2), 0) != 0 && errno == ESRCH)
+            batch->State.compare_exchange_strong(state, PL_USER_BATCH_FREE);
+    }
+    std::sort(ready, ready + numReady, [](const PL_ShmUserBatch* a, const PL_ShmUserBatch* b) {
+        return a->Ticket < b->Ticket;
+    });
+
+    int n = 0;
+    for (int i = 0; i < numReady; i++)
+    {
+        PL_ShmUserBatch* batch = ready[i];
+        int count = (int)batch->Count;
+        if (n + count > nmax)
+            break;
+
+        //** timestamps as they will be published: never before first, never
+        //** before the previous event of the batch
+        uint64_t ts = first;
+        bool due = true;
+        for (int k = 0; k < count; k++)
+        {
+            const PL_UserEvent& event = batch->Events[k];
+            uint64_t requested = event.TimeStamp ? event.TimeStamp : last;
+            if (requested > ts)
+                ts = requested;
+            if (ts > last)
+            {
+                due = false;
+                break;
+            }
+            PL_WaveLong& rec = records[n + k];
+            memset(&rec, 0, sizeof(PL_Event));
+            rec.Type = PL_ExtEventType;
+            rec.Channel = (short)event.Channel;
+            rec.Unit = event.Channel == PL_StrobedExtChannel ? (short)event.Word : 0;
+            rec.UpperTS = (unsigned char)(ts >> 32);
+            rec.TimeStamp = (PL_UINT32)ts;
+        }
+        if (!due)
+            continue;
+        n += count;
+        batch->State.store(PL_USER_BATCH_FREE, std::memory_order_release);
+    }
+    return n;
+}
+
+
+extern "C" void WINAPI PL_ServerAddDroppedEx(int type, int channel, int n, unsigned long long ts)
+{
+    if (!g_Server || n <= 0)
+        return;
+    PL_ShmHeader* hdr = g_Server->Header;
+    if (type >= 0 && type <= PL_SUB_MAX_TYPE && channel >= 0 && channel < PL_SUB_MAX_CHANNEL)
+    {
+        PL_ShmDropCounter& counter = hdr->ServerDrops[type][channel];
+        counter.Count.fetch_add((uint64_t)n, std::memory_order_relaxed);
+        if (ts)
+            counter.LastTimeStamp.store(ts, std::memory_order_relaxed);
+        hdr->ServerDroppedAttributed.fetch_add((uint64_t)n, std::memory_order_relaxed);
+    }
+    hdr->ServerDropped.fetch_add((uint64_t)n, std::memory_order_relaxed);
+}
+
+
+extern "C" int WINAPI PL_ServerGetClients(PL_ServerClientInfo* clients, int nmax)
+{
+    if (!g_Server)
+        return 0;
+
+    PL_ShmHeader* hdr = g_Server->Header;
+    int n = 0;
+    for (int i = 0; i < PL_SERVER_MAX_CLIENTS; i++)
+    {
+        PL_ShmCursor* cursor = hdr->Cursors + i;
+        uint32_t state = cursor->State.load(std::memory_order_acquire);
+        if (PL_ShmCursorIsStale(cursor, state))
+        {
+            cursor->State.compare_exchange_strong(state, PL_CURSOR_FREE);
+            continue;
+        }
+        if (state != PL_CURSOR_ACTIVE)
+            continue;
+        if (n < nmax)
+        {
+            PL_ServerClientInfo* info = clients + n;
+            info->Pid = cursor->Pid;
+            info->Type = cursor->Type;
+            info->Lag = 0;
+            for (int lane = 0; lane < PL_SHM_LANES; lane++)
+            {
+                uint64_t w = hdr->Lanes[lane].WriteIndex.load(std::memory_order_relaxed);
+                uint64_t r = cursor->ReadIndex[lane].load(std::memory_order_acquire);
+                info->Lag += r < w ? (long long)(w - r) : 0;
+            }
+            info->MMFDropped = (long long)cursor->MMFDropped.load(std::memory_order_relaxed);
+            info->ServerDropped = (long long)cursor->ServerDropped.load(std::memory_order_relaxed);
+        }
+        n++;
+    }
+    return n;
+}
+
+
+extern "C" long long WINAPI PL_ServerGetMaxLag(int* pid)
+{
+    PL_ServerClientInfo clients[PL_SERVER_MAX_CLIENTS];
+    int n = PL_ServerGetClients(clients, PL_SERVER_MAX_CLIENTS);
+    long long lag = 0;
+    if (pid)
+        *pid = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (clients[i].Lag >= lag)
+        {
+            lag = clients[i].Lag;
+            if (pid)
+                *pid = clients[i].Pid;
+        }
+    }
+    return lag;
+}
+
+
+extern "C" int WINAPI PL_ServerGetConfig(PL_ConfigSnapshot* config)
+{
+    if (!g_Server)
+        return 0;
+    //** this process is the only writer, no need to check the seqlock
+    *config = g_Server->Header->Config;
+    return 1;
+}
+
+
+extern "C" unsigned long long WINAPI PL_ServerSetConfig(const PL_ConfigSnapshot* config)
+{
+    if (!g_Server || !config)
+        return 0;
+    return WriteConfig(g_Server->Header, *config);
+}
+
+
+extern "C" void WINAPI PL_ServerClose()
+{
+    if (!g_Server)
+        return;
+    //** let waiting clients see that no more data is coming
+    g_Server->Header->Closed.store(1, std::memory_order_relaxed);
+    WakeClients(NULL);
+    munmap(g_Server->Header, g_Server->Size);
+    shm_unlink(g_Server->Name);
+    delete g_Server;
+    g_Server = NULL;
+}
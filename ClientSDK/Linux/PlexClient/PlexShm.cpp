@@ -0,0 +1,132 @@
+//
+//   PlexShm.cpp
+//
+//   Helpers shared by the client and server sides of the shared-memory ring.
+//
+
+#include "PlexShm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+
+bool PL_ShmCursorIsStale(const PL_ShmCursor* cursor, uint32_t state)
+{
+    int32_t pid;
+    if (state == PL_CURSOR_ACTIVE)
+        pid = cursor->Pid;
+    else if (state & PL_CURSOR_CLAIMING)
+        pid = (int32_t)(state & ~PL_CURSOR_CLAIMING);
+    else
+        return false;
+    return kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+
+// owner pid stored at pidOffset in the segment open as fd, 0 if none yet
+static int32_t ReadOwnerPid(int fd, size_t pidOffset)
+{
+    int32_t pid = 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= pidOffset + sizeof(pid))
+    {
+        void* p = mmap(NULL, pidOffset + sizeof(pid), PROT_READ, MAP_SHARED, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            pid = *(const volatile int32_t*)((const char*)p + pidOffset);
+            munmap(p, pidOffset + sizeof(pid));
+        }
+    }
+    return pid;
+}
+
+
+bool PL_ShmUnlinkStale(const char* name, size_t pidOffset)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return true;
+
+    //** no pid yet: in use while its creator holds the lock of PL_ShmCreate,
+    //** which it releases only after storing the pid
+    int32_t pid = ReadOwnerPid(fd, pidOffset);
+    bool inUse = false;
+    if (pid <= 0)
+    {
+        inUse = flock(fd, LOCK_EX | LOCK_NB) != 0;
+        if (!inUse)
+            pid = ReadOwnerPid(fd, pidOffset);
+    }
+    //** EPERM: the owner is alive but runs as another user
+    if (pid > 0)
+        inUse = kill(pid, 0) == 0 || errno == EPERM;
+    close(fd);
+    if (inUse)
+        return false;
+    shm_unlink(name);
+    return true;
+}
+
+
+int PL_ShmCreate(const char* name)
+{
+    for (int tries = 0; tries < 4; tries++)
+    {
+        int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+        if (fd < 0)
+            return -1;
+        flock(fd, LOCK_EX);
+
+        //** unlinked by PL_ShmUnlinkStale of another creator before the lock
+        //** was taken: the name is free again
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_nlink > 0)
+            return fd;
+        close(fd);
+    }
+    errno = EEXIST;
+    return -1;
+}
+
+
+//** the futex word lives in a MAP_SHARED segment, so the process-private
+//** futex operations cannot be used
+void PL_ShmFutexWait(std::atomic<uint32_t>* word, uint32_t expected, const struct timespec* rel)
+{
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAIT, expected, rel, NULL, 0);
+}
+
+
+void PL_ShmFutexWake(std::atomic<uint32_t>* word)
+{
+    syscall(SYS_futex, (uint32_t*)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+
+const char* PL_ShmName(const char* name)
+{
+    if (name && *name)
+        return name;
+    const char* env = getenv("PLEXON_SHM_NAME");
+    if (env && *env)
+        return env;
+    return PL_SERVER_DEFAULT_NAME;
+}
+
+
+uint64_t PL_ShmNow()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000ull + ts.tv_nsec;
+}
@@ -0,0 +1,364 @@
+//
+//   PlexShm.h
+//
+//   Fixed layout of the shared-memory ring shared by the Linux PlexClient
+//   library (client side, PlexClient.cpp) and the server side (PlexServer.cpp).
+//
+//   The segment is a PL_ShmHeader followed by one or two lanes, each an
+//   independent ring of PL_WaveLong records with its own capacity: the events
+//   lane (spikes and events, and everything else if the server made no second
+//   lane) and the continuous lane (PL_ADDataType records).  Each lane's
+//   records are followed by its shadow ring: a 64-bit summary (type, channel,
+//   timestamp) of each of the last PL_SHM_SHADOW_FACTOR * Capacity records of
+//   the lane, so a client that falls behind can still tell which channels the
+//   records it lost came from.  The shadow ring is written and validated
+//   exactly like the record ring, against WriteClaim - PL_SHM_SHADOW_FACTOR *
+//   Capacity.  Records are addressed by a 64-bit index per lane that only ever
+//   grows; record i lives in slot (i & (Capacity - 1)) and doubles as the
+//   record's sequence number within the server session (Session).  There is
+//   a single writer, which never waits for readers:
+//
+//     writer:  WriteClaim = w + n;  release fence;  copy records;
+//              WriteIndex = w + n (release)
+//     reader:  w = WriteIndex (acquire);  copy records [r, w);  acquire fence;
+//              records below WriteClaim - Capacity may have been overwritten
+//              while they were copied and must be discarded
+//
+//   A publish fills the continuous lane first and then moves both write
+//   indexes inside the PublishSeq seqlock, so a client merging the lanes by
+//   timestamp reads a pair of write indexes from the same publish.
+//
+//   Every connected client owns one PL_ShmCursor slot in the header, so the
+//   server can see how far behind each reader is without copying anything
+//   per client.
+//
+//   A client waiting for data stores the index it wants to wake at in
+//   WakeAt (per lane, or for the sum of the lanes' write indexes) and sleeps
+//   on the WakeSeq futex; after each publish the server bumps WakeSeq and
+//   wakes the clients one of whose WakeAt has been reached.  Both
+//   sides store and then load across a seq_cst fence (WakeAt/WriteIndex), so
+//   a wakeup cannot be missed.
+//
+//   Clock samples pair a MAP timestamp with the host CLOCK_MONOTONIC time it
+//   was acquired at; the last PL_SHM_CLOCK_SAMPLES of them are kept in a
+//   small ring guarded by the ClockSeq seqlock, and clients fit their clock
+//   model to it.
+//
+//   User events travel the other way, from clients to the server, through
+//   PL_SHM_USER_BATCHES batch slots: a client claims a free slot, fills it,
+//   takes a ticket and marks it ready; the server takes ready batches in
+//   ticket order and frees them.
+//
+//   The configuration (PL_ConfigSnapshot) is a seqlock: the server makes
+//   ConfigSeq odd, rewrites Config and makes ConfigSeq even again; readers
+//   copy what they need and retry if ConfigSeq changed meanwhile.
+//
+//   The snippet store (PlexSnippets.cpp) is a separate segment with the same
+//   single-writer scheme on a smaller scale: a PL_ShmSnippetHeader, one
+//   PL_ShmSnippetRing (Claim/Count, like WriteClaim/WriteIndex) per channel
+//   and unit, then the Depth waveforms of each ring.
+//
+//   The history store (PlexHistory.cpp) works the same way for continuous
+//   samples: a PL_ShmHistoryHeader, one PL_ShmHistoryRing per channel, then
+//   the samples of each ring.  Sample i of a channel was taken at
+//   Origin + i * TicksPerSample, so the slots of any time window are found
+//   without searching.
+//
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../../include/Plexon.h"
+#include "../../include/PlexServer.h"
+#include "../../include/PlexonShm.h"
+
+
+#define PL_SHM_MAGIC        (0x4d485350)    // 'PSHM'
+#define PL_SHM_VERSION      (10)
+
+static_assert(sizeof(PL_Event) == 16, "PL_Event must be 16 bytes");
+static_assert(sizeof(PL_WaveLong) == 256, "PL_WaveLong must be 256 bytes");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared-memory counters need lock-free 64-bit atomics");
+
+
+#define PL_SHM_LANES            (2)
+#define PL_SHM_LANE_EVENTS      (0)     // spikes and events; all records if there is no continuous lane
+#define PL_SHM_LANE_CONTINUOUS  (1)     // PL_ADDataType records
+#define PL_SHM_WAKE_TOTAL       (PL_SHM_LANES)  // PL_ShmCursor::WakeAt entry for the sum of the lanes
+
+// PL_ShmCursor::State
+#define PL_CURSOR_FREE      (0)
+#define PL_CURSOR_ACTIVE    (1)
+#define PL_CURSOR_CLAIMING  (0x80000000u)   // or'ed with the pid of the connecting client
+                                            // setting the slot up
+
+//
+// read position and drop counters of one client, owned by that client
+//
+struct alignas(64) PL_ShmCursor
+{
+    std::atomic<uint32_t>   State;          // PL_CURSOR_*
+    int32_t                 Pid;            // client process
+    int32_t                 Type;           // client type passed to PL_InitClient*
+    std::atomic<uint64_t>   ReadIndex[PL_SHM_LANES];    // index of the next record to read in each lane
+    std::atomic<uint64_t>   MMFDropped;     // records overwritten before this client read them
+    std::atomic<uint64_t>   ServerDropped;  // server-side drops reported to this client
+    std::atomic<uint64_t>   WakeAt[PL_SHM_LANES + 1];   // wake when a lane's WriteIndex, or the sum of
+                                                        // them, reaches this; PL_WAKE_NEVER if not waiting
+    std::atomic<uint32_t>   WakeSeq;        // futex word, bumped by the server on each wakeup
+};
+
+#define PL_WAKE_NEVER       (~(uint64_t)0)
+
+
+#define PL_SHM_CLOCK_SAMPLES    (256)   // power of two
+#define PL_SHM_SHADOW_FACTOR    (8)     // shadow ring entries per record slot, power of two
+
+//
+// server-side drops of one type and channel, reported with PL_ServerAddDroppedEx
+//
+struct PL_ShmDropCounter
+{
+    std::atomic<uint64_t>   Count;
+    std::atomic<uint64_t>   LastTimeStamp;  // MAP timestamp of the last drop
+};
+
+struct PL_ShmClockSample
+{
+    uint64_t        TimeStamp;      // 40-bit MAP timestamp
+    uint64_t        HostNanos;      // CLOCK_MONOTONIC ns at that timestamp
+};
+
+
+// PL_ShmUserBatch::State; a filling batch also holds the pid of the client
+// writing it, PL_USER_BATCH_FILLING | (pid << 2), so that the server can free
+// batches left behind by crashed clients
+#define PL_USER_BATCH_FREE      (0)
+#define PL_USER_BATCH_FILLING   (1)
+#define PL_USER_BATCH_READY     (2)
+
+#define PL_SHM_USER_BATCHES     (64)
+
+//
+// user events sent by one PL_SendUserEvents call
+//
+struct alignas(64) PL_ShmUserBatch
+{
+    std::atomic<uint32_t>   State;      // PL_USER_BATCH_*
+    uint32_t                Count;      // number of events
+    uint64_t                Ticket;     // batches are taken in ticket order
+    PL_UserEvent            Events[PL_USER_EVENT_MAX_BATCH];
+};
+
+
+//
+// one ring of records
+//
+struct PL_ShmLane
+{
+    alignas(64) std::atomic<uint64_t>   WriteClaim;     // slots up to here may be being overwritten
+    alignas(64) std::atomic<uint64_t>   WriteIndex;     // records below this index are published
+    uint64_t                            RecordsOffset;  // of the first record slot, from the header
+    uint64_t                            ShadowOffset;   // of the first shadow ring entry
+    uint32_t                            Capacity;       // number of record slots, power of two; 0 if unused
+};
+
+
+struct PL_ShmHeader
+{
+    uint32_t        Magic;          // PL_SHM_MAGIC
+    uint32_t        Version;        // PL_SHM_VERSION
+    uint32_t        HeaderSize;     // offset of the first lane's records
+    uint32_t        RecordSize;     // sizeof(PL_WaveLong)
+    int32_t         ServerPid;      // process that created the segment
+    uint64_t        Session;        // unique per PL_ServerCreate; record i has sequence number i
+
+    PL_ShmLane                          Lanes[PL_SHM_LANES];
+    alignas(64) std::atomic<uint64_t>   PublishSeq;     // odd while the lanes' write indexes are being moved
+    std::atomic<uint64_t>               PollTime;       // CLOCK_MONOTONIC ns of the last publish
+    std::atomic<uint64_t>               ServerDropped;  // cumulative server-side drops
+    std::atomic<uint64_t>               ServerDroppedAttributed;    // part of ServerDropped reported per channel
+    std::atomic<uint32_t>               Closed;         // set when the server closes the ring
+
+    PL_ShmCursor    Cursors[PL_SERVER_MAX_CLIENTS];
+
+    alignas(64) std::atomic<uint64_t>   ClockSeq;       // odd while a clock sample is being written
+    std::atomic<uint64_t>               ClockCount;     // clock samples written so far
+    PL_ShmClockSample                   Clock[PL_SHM_CLOCK_SAMPLES];   // sample i in Clock[i % PL_SHM_CLOCK_SAMPLES]
+
+    PL_ShmDropCounter   ServerDrops[PL_SUB_MAX_TYPE + 1][PL_SUB_MAX_CHANNEL];
+
+    alignas(64) std::atomic<uint64_t>   UserTicket;     // next user batch ticket
+    PL_ShmUserBatch                     UserBatches[PL_SHM_USER_BATCHES];
+
+    alignas(64) std::atomic<uint64_t>   ConfigSeq;      // odd while Config is being written
+    PL_ConfigSnapshot                   Config;         // generation is ConfigSeq / 2
+};
+
+
+#define PL_SNIPPET_MAGIC    (0x504e5350)    // 'PSNP'
+#define PL_SNIPPET_VERSION  (1)
+
+//
+// latest waveforms of one channel and unit
+//
+struct alignas(64) PL_ShmSnippetRing
+{
+    std::atomic<uint64_t>   Claim;      // slots up to here may be being overwritten
+    std::atomic<uint64_t>   Count;      // waveforms below this index are stored
+};
+
+struct PL_ShmSnippetHeader
+{
+    uint32_t        Magic;          // PL_SNIPPET_MAGIC
+    uint32_t        Version;        // PL_SNIPPET_VERSION
+    uint32_t        Channels;       // DSP channels 1 to Channels
+    uint32_t        Depth;          // waveforms per ring, power of two
+    uint32_t        RecordSize;     // sizeof(PL_WaveLong)
+    int32_t         OwnerPid;       // process filling the store
+};
+
+static_assert(sizeof(PL_ShmSnippetHeader) <= sizeof(PL_ShmSnippetRing),
+              "the snippet header must fit in the space of one ring");
+
+
+#define PL_HISTORY_MAGIC    (0x53485350)    // 'PSHS'
+#define PL_HISTORY_VERSION  (2)
+
+//
+// recent samples of one continuous channel
+//
+struct alignas(64) PL_ShmHistoryRing
+{
+    std::atomic<uint64_t>   Claim;      // samples up to here may be being overwritten
+    std::atomic<uint64_t>   Count;      // samples below this index are stored
+    std::atomic<uint64_t>   Origin;     // timestamp of sample 0, valid once Count > 0
+    std::atomic<uint64_t>   Missing;    // samples never received, stored as 0
+    uint64_t                Offset;     // first sample of the ring, in samples from the start of all samples
+    uint32_t                Depth;      // samples in the ring, power of two
+    uint32_t                Frequency;  // samples per second
+    uint32_t                TickRate;   // timestamp ticks per second; sample i was taken
+                                        // round(i*TickRate/Frequency) ticks after Origin
+};
+
+struct PL_ShmHistoryHeader
+{
+    uint32_t        Magic;          // PL_HISTORY_MAGIC
+    uint32_t        Version;        // PL_HISTORY_VERSION
+    uint32_t        Channels;       // continuous channels 0 to Channels - 1
+    int32_t         OwnerPid;       // process filling the store
+};
+
+static_assert(sizeof(PL_ShmHistoryHeader) <= sizeof(PL_ShmHistoryRing),
+              "the history header must fit in the space of one ring");
+
+
+// lanes follow the header, rounded up to a cache line
+inline size_t PL_ShmHeaderSize()
+{
+    return (sizeof(PL_ShmHeader) + 63) & ~(size_t)63;
+}
+
+// byte size of one lane of capacity records, with its shadow ring
+inline size_t PL_ShmLaneSize(uint32_t capacity)
+{
+    return (size_t)capacity*(sizeof(PL_WaveLong) + PL_SHM_SHADOW_FACTOR*sizeof(uint64_t));
+}
+
+// byte size of a segment with lanes of the given capacities
+inline size_t PL_ShmSize(uint32_t capacity, uint32_t continuousCapacity)
+{
+    return PL_ShmHeaderSize() + PL_ShmLaneSize(capacity) + PL_ShmLaneSize(continuousCapacity);
+}
+
+// first record slot of a lane of a mapped segment
+inline PL_WaveLong* PL_ShmRecords(PL_ShmHeader* hdr, int lane)
+{
+    return (PL_WaveLong*)((char*)hdr + hdr->Lanes[lane].RecordsOffset);
+}
+
+// first entry of a lane's shadow ring, which follows its records
+inline uint64_t* PL_ShmShadow(PL_ShmHeader* hdr, int lane)
+{
+    return (uint64_t*)((char*)hdr + hdr->Lanes[lane].ShadowOffset);
+}
+
+// shadow ring entry of a record: timestamp in the upper 40 bits, then type
+// and channel
+inline uint64_t PL_ShmShadowEntry(const PL_WaveLong& rec)
+{
+    return ((((uint64_t)rec.UpperTS << 32) | rec.TimeStamp) << 24) |
+           ((uint64_t)(unsigned char)rec.Type << 16) | (unsigned short)rec.Channel;
+}
+
+inline uint64_t PL_ShmShadowTimeStamp(uint64_t entry) { return entry >> 24; }
+inline unsigned PL_ShmShadowType(uint64_t entry) { return (unsigned)(entry >> 16) & 0xff; }
+inline unsigned PL_ShmShadowChannel(uint64_t entry) { return (unsigned)entry & 0xffff; }
+
+// full 40-bit timestamp of a record
+inline uint64_t PL_ShmTimeStamp(const PL_WaveLong& rec)
+{
+    return ((uint64_t)rec.UpperTS << 32) | rec.TimeStamp;
+}
+
+// rings follow the snippet header, then the waveforms of each ring in turn
+inline size_t PL_ShmSnippetSize(uint32_t channels, uint32_t depth)
+{
+    size_t rings = (size_t)channels*PL_SNIPPET_UNITS;
+    return sizeof(PL_ShmSnippetRing) + rings*(sizeof(PL_ShmSnippetRing) + depth*sizeof(PL_WaveLong));
+}
+
+inline PL_ShmSnippetRing* PL_ShmSnippetRings(PL_ShmSnippetHeader* hdr)
+{
+    return (PL_ShmSnippetRing*)((char*)hdr + sizeof(PL_ShmSnippetRing));
+}
+
+inline PL_WaveLong* PL_ShmSnippetRecords(PL_ShmSnippetHeader* hdr)
+{
+    return (PL_WaveLong*)(PL_ShmSnippetRings(hdr) + (size_t)hdr->Channels*PL_SNIPPET_UNITS);
+}
+
+// rings follow the history header, then the samples of each ring in turn
+inline size_t PL_ShmHistorySize(uint32_t channels, uint64_t samples)
+{
+    return sizeof(PL_ShmHistoryRing) + channels*sizeof(PL_ShmHistoryRing) + samples*sizeof(short);
+}
+
+inline PL_ShmHistoryRing* PL_ShmHistoryRings(PL_ShmHistoryHeader* hdr)
+{
+    return (PL_ShmHistoryRing*)((char*)hdr + sizeof(PL_ShmHistoryRing));
+}
+
+inline short* PL_ShmHistorySamples(PL_ShmHistoryHeader* hdr)
+{
+    return (short*)(PL_ShmHistoryRings(hdr) + hdr->Channels);
+}
+
+// true if the cursor, whose State was read as state, belongs to a client
+// process that has exited, whether it was still setting the slot up or not
+bool PL_ShmCursorIsStale(const PL_ShmCursor* cursor, uint32_t state);
+
+// unlinks the segment called name unless the process whose id is stored at
+// pidOffset in it is still running; returns false if the name is in use
+bool PL_ShmUnlinkStale(const char* name, size_t pidOffset);
+
+// creates the segment called name, which must not exist, and locks it until
+// the returned descriptor is closed; close it once the owner pid is stored,
+// PL_ShmUnlinkStale treats a locked segment without one as in use
+int PL_ShmCreate(const char* name);
+
+// futex wait on a word in shared memory; rel is a relative timeout or NULL
+void PL_ShmFutexWait(std::atomic<uint32_t>* word, uint32_t expected, const struct timespec* rel);
+
+// wakes all waiters on a futex word in shared memory
+void PL_ShmFutexWake(std::atomic<uint32_t>* word);
+
+// name of the shared-memory object, honouring PLEXON_SHM_NAME
+const char* PL_ShmName(const char* name);
+
+// CLOCK_MONOTONIC in nanoseconds
+uint64_t PL_ShmNow();
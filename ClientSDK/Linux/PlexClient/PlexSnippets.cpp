@@ -0,0 +1,233 @@
+//
+//   PlexSnippets.cpp
+//
+//   Snippet store of the Linux PlexClient library: the latest waveforms of
+//   every channel and unit in a shared-memory segment of their own, filled by
+//   one process and read by any number of others.  See PlexonShm.h.
+//
+//   Each ring has a single writer and is validated exactly like the record
+//   ring (see PlexShm.h): readers copy [Count - k, Count) and then discard
+//   the snippets below Claim - Depth, which may have been overwritten.
+//
+
+#include "PlexShm.h"
+
+#include <fcntl.h>
+#include <new>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//
+// snippet store open in this process
+//
+struct CSnippets
+{
+    char                    Name[256];
+    size_t                  Size;
+    PL_ShmSnippetHeader*    Header;
+    PL_ShmSnippetRing*      Rings;
+    PL_WaveLong*            Records;
+    uint64_t                Mask;
+    bool                    Owner;      // created by this process, which fills it
+};
+
+static CSnippets* g_Snippets = NULL;
+
+// copies are retried this many times before returning the intact part
+#define SNIPPET_READ_TRIES  (4)
+
+
+static const char* SnippetName(const char* name)
+{
+    return name && *name ? name : PL_SNIPPET_DEFAULT_NAME;
+}
+
+
+static void OpenSnippets(const char* name, void* p, size_t size, bool owner)
+{
+    g_Snippets = new CSnippets();
+    snprintf(g_Snippets->Name, sizeof(g_Snippets->Name), "%s", name);
+    g_Snippets->Size = size;
+    g_Snippets->Header = (PL_ShmSnippetHeader*)p;
+    g_Snippets->Rings = PL_ShmSnippetRings(g_Snippets->Header);
+    g_Snippets->Records = PL_ShmSnippetRecords(g_Snippets->Header);
+    g_Snippets->Mask = (uint64_t)g_Snippets->Header->Depth - 1;
+    g_Snippets->Owner = owner;
+}
+
+
+extern "C" int WINAPI PL_CreateSnippetStore(const char* name, int channels, int depth)
+{
+    if (g_Snippets || channels <= 0 || channels > PL_SUB_MAX_CHANNEL || depth < 0 || depth > (1 << 20))
+        return 0;
+    uint32_t size2 = 2;
+    while (size2 < (uint32_t)(depth ? depth : PL_SNIPPET_DEFAULT_DEPTH))
+        size2 *= 2;
+
+    name = SnippetName(name);
+    size_t size = PL_ShmSnippetSize((uint32_t)channels, size2);
+
+    //** a stale segment left by a process that died is replaced, a live one is left alone
+    if (!PL_ShmUnlinkStale(name, offsetof(PL_ShmSnippetHeader, OwnerPid)))
+    {
+        fprintf(stderr, "PL_CreateSnippetStore: %s is in use by a running process\n", name);
+        return 0;
+    }
+    int fd = PL_ShmCreate(name);
+    if (fd < 0)
+    {
+        perror("PL_CreateSnippetStore: shm_open");
+        return 0;
+    }
+    fchmod(fd, 0666); //** not subject to umask, so displays of other users can read it
+    if (ftruncate(fd, (off_t)size) != 0)
+    {
+        perror("PL_CreateSnippetStore: ftruncate");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        perror("PL_CreateSnippetStore: mmap");
+        close(fd);
+        shm_unlink(name);
+        return 0;
+    }
+
+    //** the segment is zero-filled, so every ring starts empty
+    PL_ShmSnippetHeader* hdr = new (p) PL_ShmSnippetHeader();
+    hdr->Version = PL_SNIPPET_VERSION;
+    hdr->Channels = (uint32_t)channels;
+    hdr->Depth = size2;
+    hdr->RecordSize = sizeof(PL_WaveLong);
+    hdr->OwnerPid = getpid();
+    close(fd); //** releases the creation lock
+
+    //** the magic number goes in last: readers refuse a segment without it
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->Magic = PL_SNIPPET_MAGIC;
+
+    OpenSnippets(name, p, size, true);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_PutSnippets(const PL_WaveLong* records, int n)
+{
+    if (!g_Snippets || !g_Snippets->Owner || !records)
+        return 0;
+    uint32_t channels = g_Snippets->Header->Channels;
+    int stored = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const PL_WaveLong& rec = records[i];
+        uint32_t ch = (uint32_t)rec.Channel - 1;
+        uint32_t unit = (uint32_t)rec.Unit;
+        if (rec.Type != PL_SingleWFType || ch >= channels || unit >= PL_SNIPPET_UNITS)
+            continue;
+        uint64_t index = (uint64_t)ch*PL_SNIPPET_UNITS + unit;
+        PL_ShmSnippetRing& ring = g_Snippets->Rings[index];
+        uint64_t count = ring.Count.load(std::memory_order_relaxed);
+        ring.Claim.store(count + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(g_Snippets->Records + (index*(g_Snippets->Mask + 1) + (count & g_Snippets->Mask)),
+               &rec, sizeof(PL_WaveLong));
+        ring.Count.store(count + 1, std::memory_order_release);
+        stored++;
+    }
+    return stored;
+}
+
+
+extern "C" int WINAPI PL_OpenSnippetStore(const char* name)
+{
+    if (g_Snippets)
+        return 0;
+    name = SnippetName(name);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PL_ShmSnippetRing))
+    {
+        close(fd);
+        return 0;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return 0;
+
+    PL_ShmSnippetHeader* hdr = (PL_ShmSnippetHeader*)p;
+    if (hdr->Magic != PL_SNIPPET_MAGIC || hdr->Version != PL_SNIPPET_VERSION ||
+        hdr->RecordSize != sizeof(PL_WaveLong) || hdr->Depth < 2 || (hdr->Depth & (hdr->Depth - 1)) != 0 ||
+        PL_ShmSnippetSize(hdr->Channels, hdr->Depth) > (size_t)st.st_size)
+    {
+        munmap(p, (size_t)st.st_size);
+        return 0;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    OpenSnippets(name, p, (size_t)st.st_size, false);
+    return 1;
+}
+
+
+extern "C" int WINAPI PL_GetLatestSnippets(int channel, int unit, int nmax,
+                                           PL_WaveLong* snippets, unsigned long long* total)
+{
+    if (total)
+        *total = 0;
+    if (!g_Snippets || !snippets || nmax <= 0 || channel < 1 ||
+        (uint32_t)channel > g_Snippets->Header->Channels || unit < 0 || unit >= PL_SNIPPET_UNITS)
+        return 0;
+    uint64_t index = (uint64_t)(channel - 1)*PL_SNIPPET_UNITS + unit;
+    const PL_ShmSnippetRing& ring = g_Snippets->Rings[index];
+    const PL_WaveLong* records = g_Snippets->Records + index*(g_Snippets->Mask + 1);
+    uint64_t depth = g_Snippets->Mask + 1;
+
+    uint64_t count = 0, copied = 0, lost = 0;
+    for (int tries = 0; tries < SNIPPET_READ_TRIES; tries++)
+    {
+        count = ring.Count.load(std::memory_order_acquire);
+        copied = count < depth ? count : depth;
+        if (copied > (uint64_t)nmax)
+            copied = (uint64_t)nmax;
+        for (uint64_t i = count - copied; i < count; i++)
+            memcpy(snippets + (i - (count - copied)), records + (i & g_Snippets->Mask), sizeof(PL_WaveLong));
+
+        //** snippets below Claim - Depth may have been overwritten while they were copied
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t claim = ring.Claim.load(std::memory_order_relaxed);
+        uint64_t valid = claim > depth ? claim - depth : 0;
+        lost = valid > count - copied ? valid - (count - copied) : 0;
+        if (lost == 0)
+            break;
+    }
+    if (lost > copied)
+        lost = copied;
+    if (lost)
+        memmove(snippets, snippets + lost, (size_t)(copied - lost)*sizeof(PL_WaveLong));
+    if (total)
+        *total = count;
+    return (int)(copied - lost);
+}
+
+
+extern "C" void WINAPI PL_CloseSnippetStore()
+{
+    if (!g_Snippets)
+        return;
+    munmap(g_Snippets->Header, g_Snippets->Size);
+    if (g_Snippets->Owner)
+        shm_unlink(g_Snippets->Name);
+    delete g_Snippets;
+    g_Snippets = NULL;
+}
@@ -0,0 +1,184 @@
+//
+//   PlexNet.cpp
+//
+//   Frame encoding and socket helpers of the PlexNet bridge.  See PlexNet.h.
+//
+
+#include "PlexNet.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+
+static inline uint64_t ZigZag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+
+static inline int64_t UnZigZag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+
+static inline unsigned char* PutVarint(unsigned char* p, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+
+static inline bool GetVarint(const unsigned char*& p, const unsigned char* end, uint64_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7)
+    {
+        unsigned char b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+void PL_NetEncodeFrame(const PL_WaveLong* records, int n, int serverDropped, int mmfDropped,
+                       std::vector<unsigned char>& out)
+{
+    size_t start = out.size();
+    out.resize(start + sizeof(PL_NetFrameHeader) + (size_t)n*PL_NET_MAX_RECORD_BYTES);
+
+    PL_NetFrameHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = PL_NET_FRAME_MAGIC;
+    header.NumRecords = (uint32_t)n;
+    header.ServerDropped = serverDropped;
+    header.MMFDropped = mmfDropped;
+    header.FirstTimeStamp = n > 0 ? ((uint64_t)records[0].UpperTS << 32) | records[0].TimeStamp : 0;
+
+    unsigned char* payload = &out[start + sizeof(header)];
+    unsigned char* p = payload;
+    uint64_t prev = header.FirstTimeStamp;
+    for (int i = 0; i < n; i++)
+    {
+        const PL_WaveLong& rec = records[i];
+        uint64_t ts = ((uint64_t)rec.UpperTS << 32) | rec.TimeStamp;
+        int words = rec.NumberOfDataWords < 0 ? 0 : rec.NumberOfDataWords;
+        if (words > MAX_WF_LENGTH_LONG)
+            words = MAX_WF_LENGTH_LONG;
+
+        p = PutVarint(p, ZigZag((int64_t)(ts - prev)));
+        prev = ts;
+        *p++ = (unsigned char)rec.Type;
+        p = PutVarint(p, ZigZag(rec.Channel));
+        p = PutVarint(p, ZigZag(rec.Unit));
+        *p++ = (unsigned char)words;
+        int last = 0;
+        for (int j = 0; j < words; j++)
+        {
+            p = PutVarint(p, ZigZag(rec.WaveForm[j] - last));
+            last = rec.WaveForm[j];
+        }
+    }
+
+    header.PayloadBytes = (uint32_t)(p - payload);
+    memcpy(&out[start], &header, sizeof(header));
+    out.resize(start + sizeof(header) + header.PayloadBytes);
+}
+
+
+bool PL_NetFrameSizeOk(const PL_NetFrameHeader& header)
+{
+    return header.PayloadBytes <= PL_NET_MAX_PAYLOAD_BYTES &&
+           header.NumRecords <= header.PayloadBytes/PL_NET_MIN_RECORD_BYTES;
+}
+
+
+bool PL_NetDecodeFrame(const PL_NetFrameHeader& header, const unsigned char* payload,
+                       std::vector<PL_WaveLong>& records)
+{
+    if (!PL_NetFrameSizeOk(header))
+        return false;
+    records.resize(header.NumRecords);
+    const unsigned char* p = payload;
+    const unsigned char* end = payload + header.PayloadBytes;
+    uint64_t ts = header.FirstTimeStamp;
+    uint64_t v;
+
+    for (uint32_t i = 0; i < header.NumRecords; i++)
+    {
+        PL_WaveLong& rec = records[i];
+        memset(&rec, 0, sizeof(PL_Event));
+
+        if (!GetVarint(p, end, v))
+            return false;
+        ts += (uint64_t)UnZigZag(v);
+        rec.UpperTS = (unsigned char)(ts >> 32);
+        rec.TimeStamp = (PL_UINT32)ts;
+        if (p >= end)
+            return false;
+        rec.Type = (char)*p++;
+        if (!GetVarint(p, end, v))
+            return false;
+        rec.Channel = (short)UnZigZag(v);
+        if (!GetVarint(p, end, v))
+            return false;
+        rec.Unit = (short)UnZigZag(v);
+        if (p >= end || *p > MAX_WF_LENGTH_LONG)
+            return false;
+        int words = *p++;
+        rec.NumberOfDataWords = (char)words;
+
+        int last = 0;
+        for (int j = 0; j < words; j++)
+        {
+            if (!GetVarint(p, end, v))
+                return false;
+            last += (int)UnZigZag(v);
+            rec.WaveForm[j] = (short)last;
+        }
+        memset(rec.WaveForm + words, 0, (MAX_WF_LENGTH_LONG - words)*sizeof(short));
+    }
+    return p == end;
+}
+
+
+bool PL_NetSendAll(int fd, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, p, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        p += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+
+bool PL_NetRecvAll(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0)
+    {
+        ssize_t got = recv(fd, p, size, 0);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+        p += got;
+        size -= (size_t)got;
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+//
+//   PlexNet.h
+//
+//   Wire format of the PlexNet bridge, which streams the MAP event stream of a
+//   Linux shared-memory server to remote machines over TCP.
+//
+//   PlexNetServer runs next to the server and forks one child per remote
+//   connection; the child connects to the local ring as an ordinary client with
+//   the remote side's subscription filter and decimation and streams what it
+//   reads, so that a monitor thinned to a few waveforms per second costs
+//   correspondingly less bandwidth than a recorder.
+//   PlexNetClient runs on the remote machine and republishes the stream into a
+//   local shared-memory ring, so clients there use the unchanged Plexon.h read
+//   calls.
+//
+//   Connection:  client -> server   PL_NetHello
+//                server -> client   PL_NetHelloReply
+//                server -> client   PL_NetFrameHeader + payload, repeated
+//
+//   A frame with Magic PL_NET_CONFIG_MAGIC carries a PL_ConfigSnapshot
+//   instead of records; the server sends one before the first records and
+//   again whenever the configuration generation changes.
+//
+//   A frame carries the records of one server read.  Each record is encoded
+//   as varints: zigzag delta of the 40-bit timestamp from the previous record
+//   (the first from FirstTimeStamp), Type, zigzag Channel, zigzag Unit,
+//   NumberOfDataWords, then the waveform as the zigzag first point followed by
+//   zigzag differences of successive points.  All fixed-size fields are
+//   little-endian.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+#include "../../include/PlexServer.h"
+
+
+#define PL_NET_DEFAULT_PORT     (5100)
+#define PL_NET_HELLO_MAGIC      (0x484c4e50)    // 'PNLH'
+#define PL_NET_FRAME_MAGIC      (0x464c4e50)    // 'PNLF'
+#define PL_NET_CONFIG_MAGIC     (0x434c4e50)    // 'PNLC'
+#define PL_NET_VERSION          (4)
+
+// upper bound of the encoded size of one record
+#define PL_NET_MAX_RECORD_BYTES (10 + 1 + 3 + 3 + 1 + 3*MAX_WF_LENGTH_LONG)
+
+// lower bound of the encoded size of one record (no waveform, one-byte varints)
+#define PL_NET_MIN_RECORD_BYTES (5)
+
+// maximum number of records sent as one frame, and the largest payload a
+// receiver accepts
+#define PL_NET_MAX_FRAME_RECORDS (65536)
+#define PL_NET_MAX_PAYLOAD_BYTES (PL_NET_MAX_FRAME_RECORDS*PL_NET_MAX_RECORD_BYTES)
+
+
+struct PL_NetHello
+{
+    uint32_t        Magic;              // PL_NET_HELLO_MAGIC
+    uint32_t        Version;            // PL_NET_VERSION
+    uint32_t        Filtered;           // nonzero if Subscription applies
+    PL_Subscription Subscription;       // records the remote client wants
+    uint32_t        Decimated;          // nonzero if Decimation applies
+    PL_Decimation   Decimation;         // thinning of the records it wants
+};
+
+struct PL_NetHelloReply
+{
+    uint32_t        Magic;              // PL_NET_HELLO_MAGIC
+    uint32_t        Version;            // PL_NET_VERSION
+    PL_ServerInfo   Info;               // parameters of the server being bridged
+};
+
+struct PL_NetFrameHeader
+{
+    uint32_t        Magic;              // PL_NET_FRAME_MAGIC or PL_NET_CONFIG_MAGIC
+    uint32_t        PayloadBytes;       // bytes of encoded records that follow
+    uint32_t        NumRecords;         // records in the payload
+    int32_t         ServerDropped;      // drops reported with this read
+    int32_t         MMFDropped;
+    uint32_t        Reserved;
+    uint64_t        FirstTimeStamp;     // base of the first timestamp delta
+};
+
+
+// appends one frame (header and payload) holding n records to out
+void PL_NetEncodeFrame(const PL_WaveLong* records, int n, int serverDropped, int mmfDropped,
+                       std::vector<unsigned char>& out);
+
+// true if the sizes in a frame header received from the network are plausible;
+// checked before anything is allocated for the frame
+bool PL_NetFrameSizeOk(const PL_NetFrameHeader& header);
+
+// decodes the payload of a frame into records (replacing its contents);
+// returns false if the payload is malformed
+bool PL_NetDecodeFrame(const PL_NetFrameHeader& header, const unsigned char* payload,
+                       std::vector<PL_WaveLong>& records);
+
+// sends or receives exactly size bytes on a socket; false on error or EOF
+bool PL_NetSendAll(int fd, const void* data, size_t size);
+bool PL_NetRecvAll(int fd, void* data, size_t size);
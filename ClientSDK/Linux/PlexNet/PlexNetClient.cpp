@@ -0,0 +1,261 @@
+//
+//   PlexNetClient.cpp
+//
+//   Client side of the PlexNet bridge: connects to a PlexNetServer, receives
+//   the (optionally subscription-filtered) MAP event stream and republishes it
+//   into a local shared-memory ring.  Clients on this machine then read it
+//   with the usual Plexon.h calls, with PLEXON_SHM_NAME set to the ring name.
+//
+//   Usage: PlexNetClient [-h host] [-p port] [-n shmname] [-q capacity]
+//                        [-s type:first-last]... [-u unitmask]
+//                        [-w waveforms_per_s] [-c factor] [-e] [-v]
+//
+//   Each -s selects a channel range of one record type, e.g. -s 1:1-16 for
+//   spikes on the first 16 DSP channels or -s 4:257-257 for strobed events;
+//   without -s every record is received.  -w keeps at most the given number of
+//   waveforms per second of every unit (all spike timestamps still arrive),
+//   -c keeps one continuous sample in factor, or with -e the min and max of
+//   every factor samples; the thinning is done by PlexNetServer, before the
+//   network (see PL_SetDecimation).  The local ring reports the rate of the
+//   words that arrive, so factor must divide every continuous rate, or twice
+//   it with -e, whose min and max read as samples half a group apart.  -v
+//   prints throughput once per second.
+//
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "PlexNet.h"
+
+
+static volatile sig_atomic_t g_Stop = 0;
+
+static void OnSignal(int)
+{
+  g_Stop = 1;
+}
+
+
+//** connects to host:port, returns the socket or -1
+static int Connect(const char* host, int port)
+{
+  addrinfo Hints, *Result;
+  char Service[16];
+  memset(&Hints, 0, sizeof(Hints));
+  Hints.ai_family = AF_UNSPEC;
+  Hints.ai_socktype = SOCK_STREAM;
+  snprintf(Service, sizeof(Service), "%d", port);
+  if (getaddrinfo(host, Service, &Hints, &Result) != 0)
+    return -1;
+
+  int fd = -1;
+  for (addrinfo* a = Result; a; a = a->ai_next)
+  {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+      break;
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(Result);
+  return fd;
+}
+
+
+static double Now()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
+//** scales a continuous rate to that of the records that arrive: factor
+//** samples become words words (1, or a min and a max with -e, which then
+//** read as samples half a group apart); false if the rate can't be kept exact
+static bool ScaleRate(int* freq, int words, int factor)
+{
+  if (*freq <= 0 || factor <= 1)
+    return true;
+  if (*freq*words % factor)
+    return false;
+  *freq = *freq*words/factor;
+  return true;
+}
+
+
+//** scales every continuous rate of a configuration, see ScaleRate
+static bool ScaleRates(PL_ConfigSnapshot* config, int words, int factor)
+{
+  bool ok = ScaleRate(&config->Info.SlowFrequency, words, factor);
+  for (int ch = 0; ch < PL_CONFIG_MAX_SLOW_CHANNELS; ch++)
+    ok = ScaleRate(&config->SlowFrequencies[ch], words, factor) && ok;
+  return ok;
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char*   Host = "127.0.0.1";
+  int           Port = PL_NET_DEFAULT_PORT;
+  const char*   ShmName = "/PlexonRemote";
+  int           Capacity = 0;
+  int           Verbose = 0;
+  PL_NetHello   Hello;
+  int           Factor = 1;           //** continuous samples per Words words kept
+  int           Words = 1;
+  int           opt;
+
+  memset(&Hello, 0, sizeof(Hello));
+  Hello.Magic = PL_NET_HELLO_MAGIC;
+  Hello.Version = PL_NET_VERSION;
+  PL_SubscriptionInit(&Hello.Subscription, 0);
+
+  while ((opt = getopt(argc, argv, "h:p:n:q:s:u:w:c:ev")) != -1)
+  {
+    int Type, First, Last;
+    switch (opt)
+    {
+      case 'h': Host = optarg; break;
+      case 'p': Port = atoi(optarg); break;
+      case 'n': ShmName = optarg; break;
+      case 'q': Capacity = atoi(optarg); break;
+      case 's':
+        if (sscanf(optarg, "%d:%d-%d", &Type, &First, &Last) != 3)
+        {
+          fprintf(stderr, "bad channel range '%s', expected type:first-last\n", optarg);
+          return 1;
+        }
+        PL_SubscriptionAddChannels(&Hello.Subscription, Type, First, Last);
+        Hello.Filtered = 1;
+        break;
+      case 'u': Hello.Subscription.UnitMask = (unsigned)strtoul(optarg, NULL, 0); Hello.Filtered = 1; break;
+      case 'w': Hello.Decimation.WaveformRate = atoi(optarg); Hello.Decimated = 1; break;
+      case 'c': Hello.Decimation.ContinuousFactor = atoi(optarg); Hello.Decimated = 1; break;
+      case 'e': Hello.Decimation.ContinuousMode = PL_DECIMATE_ENVELOPE; Hello.Decimated = 1; break;
+      case 'v': Verbose = 1; break;
+      default:
+        fprintf(stderr, "usage: %s [-h host] [-p port] [-n shmname] [-q capacity] "
+                "[-s type:first-last]... [-u unitmask] [-w waveforms_per_s] [-c factor] [-e] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+  //** a unit mask alone keeps every type and channel
+  if (Hello.Filtered && Hello.Subscription.TypeMask == 0)
+  {
+    unsigned UnitMask = Hello.Subscription.UnitMask;
+    PL_SubscriptionInit(&Hello.Subscription, 1);
+    Hello.Subscription.UnitMask = UnitMask;
+  }
+
+  if (Hello.Decimation.ContinuousFactor > 1)
+  {
+    Factor = Hello.Decimation.ContinuousFactor;
+    Words = Hello.Decimation.ContinuousMode == PL_DECIMATE_ENVELOPE ? 2 : 1;
+  }
+
+  int fd = Connect(Host, Port);
+  if (fd < 0)
+  {
+    fprintf(stderr, "couldn't connect to %s:%d\n", Host, Port);
+    return 1;
+  }
+  int On = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &On, sizeof(On));
+
+  PL_NetHelloReply Reply;
+  if (!PL_NetSendAll(fd, &Hello, sizeof(Hello)) || !PL_NetRecvAll(fd, &Reply, sizeof(Reply)) ||
+      Reply.Magic != PL_NET_HELLO_MAGIC || Reply.Version != PL_NET_VERSION)
+  {
+    fprintf(stderr, "PlexNet handshake with %s:%d failed\n", Host, Port);
+    close(fd);
+    return 1;
+  }
+
+  //** local clients see the rate of the samples that actually arrive
+  if (!ScaleRate(&Reply.Info.SlowFrequency, Words, Factor))
+  {
+    fprintf(stderr, "-c %d does not divide the continuous rate of %d Hz%s\n", Factor,
+            Reply.Info.SlowFrequency, Words > 1 ? " into pairs" : "");
+    close(fd);
+    return 1;
+  }
+  if (!PL_ServerCreate(ShmName, Capacity, &Reply.Info))
+  {
+    fprintf(stderr, "couldn't create the shared-memory ring %s\n", ShmName);
+    close(fd);
+    return 1;
+  }
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  printf("PlexNetClient: %s:%d -> %s\n", Host, Port, ShmName);
+  fflush(stdout);
+
+  std::vector<unsigned char> Payload;
+  std::vector<PL_WaveLong> Records;
+  std::vector<PL_ConfigSnapshot> Config(1);
+  PL_NetFrameHeader Header;
+  unsigned long long TotalRecords = 0, TotalBytes = 0;
+  double NextReport = Now() + 1.0;
+
+  while (!g_Stop)
+  {
+    if (!PL_NetRecvAll(fd, &Header, sizeof(Header)))
+      break;
+    if (Header.Magic == PL_NET_CONFIG_MAGIC && Header.PayloadBytes == sizeof(PL_ConfigSnapshot))
+    {
+      //** the local ring gets its own generations, so local clients only
+      //** see that the configuration changed
+      if (!PL_NetRecvAll(fd, Config.data(), sizeof(PL_ConfigSnapshot)))
+        break;
+      if (!ScaleRates(Config.data(), Words, Factor))
+      {
+        fprintf(stderr, "PlexNetClient: -c %d does not divide every continuous rate\n", Factor);
+        break;
+      }
+      PL_ServerSetConfig(Config.data());
+      continue;
+    }
+    if (Header.Magic != PL_NET_FRAME_MAGIC || !PL_NetFrameSizeOk(Header))
+    {
+      fprintf(stderr, "PlexNetClient: bad frame\n");
+      break;
+    }
+    Payload.resize(Header.PayloadBytes);
+    if (!PL_NetRecvAll(fd, Payload.data(), Payload.size()) ||
+        !PL_NetDecodeFrame(Header, Payload.data(), Records))
+    {
+      fprintf(stderr, "PlexNetClient: bad frame payload\n");
+      break;
+    }
+
+    PL_ServerAddDropped(Header.ServerDropped + Header.MMFDropped);
+    PL_ServerPutRecords(Records.data(), (int)Records.size());
+
+    TotalRecords += Records.size();
+    TotalBytes += sizeof(Header) + Header.PayloadBytes;
+    if (Verbose && Now() >= NextReport)
+    {
+      printf("%llu records, %llu bytes received (%.1f bytes/record, %.1fx smaller than PL_WaveLong)\n",
+        TotalRecords, TotalBytes, TotalRecords ? (double)TotalBytes/TotalRecords : 0.0,
+        TotalBytes ? (double)TotalRecords*sizeof(PL_WaveLong)/TotalBytes : 0.0);
+      fflush(stdout);
+      NextReport += 1.0;
+    }
+  }
+
+  printf("PlexNetClient: connection closed after %llu records\n", TotalRecords);
+  close(fd);
+  PL_ServerClose();
+  return 0;
+}
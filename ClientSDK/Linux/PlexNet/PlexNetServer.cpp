@@ -0,0 +1,173 @@
+//
+//   PlexNetServer.cpp
+//
+//   Server side of the PlexNet bridge: accepts TCP connections from
+//   PlexNetClient and streams the local server's MAP event stream to each of
+//   them in batched, delta-encoded frames (see PlexNet.h).  Every connection
+//   is served by its own child process, which reads the shared-memory ring as
+//   an ordinary client with the subscription filter and decimation sent by the
+//   remote side.
+//
+//   Usage: PlexNetServer [-p port]
+//
+//   The ring is the one named by PLEXON_SHM_NAME, or /PlexonServer.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "PlexNet.h"
+
+
+//** sends the configuration of the local server if it changed since the last call
+static bool SendConfig(int fd, PL_ConfigSnapshot* config)
+{
+  if (config->Generation == PL_GetConfigGeneration())
+    return true;
+  PL_GetConfigSnapshot(config);
+
+  PL_NetFrameHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  Header.Magic = PL_NET_CONFIG_MAGIC;
+  Header.PayloadBytes = sizeof(*config);
+  return PL_NetSendAll(fd, &Header, sizeof(Header)) && PL_NetSendAll(fd, config, sizeof(*config));
+}
+
+
+//** true once the remote side has closed its end of the connection
+static bool PeerClosed(int fd)
+{
+  char c;
+  return recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0;
+}
+
+
+//** streams the local ring to one remote client until either side goes away
+static int ServeClient(int fd)
+{
+  PL_NetHello Hello;
+  if (!PL_NetRecvAll(fd, &Hello, sizeof(Hello)) ||
+      Hello.Magic != PL_NET_HELLO_MAGIC || Hello.Version != PL_NET_VERSION)
+  {
+    fprintf(stderr, "PlexNetServer: bad hello from client\n");
+    return 1;
+  }
+
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    fprintf(stderr, "PlexNetServer: couldn't connect to the local server\n");
+    return 1;
+  }
+  if (Hello.Filtered)
+    PL_SetSubscription(&Hello.Subscription);
+  if (Hello.Decimated && !PL_SetDecimation(&Hello.Decimation))
+  {
+    fprintf(stderr, "PlexNetServer: bad decimation from client\n");
+    PL_CloseClient();
+    return 1;
+  }
+
+  std::vector<PL_ConfigSnapshot> Config(1);
+  PL_GetConfigSnapshot(Config.data());
+
+  PL_NetHelloReply Reply;
+  memset(&Reply, 0, sizeof(Reply));
+  Reply.Magic = PL_NET_HELLO_MAGIC;
+  Reply.Version = PL_NET_VERSION;
+  Reply.Info = Config[0].Info;
+  Config[0].Generation = 0; //** forces the first config frame
+  if (!PL_NetSendAll(fd, &Reply, sizeof(Reply)))
+  {
+    PL_CloseClient();
+    return 1;
+  }
+
+  std::vector<PL_WaveLong> Records(PL_NET_MAX_FRAME_RECORDS);
+  std::vector<unsigned char> Frame;
+  int ServerDropped, MMFDropped, PollHigh, PollLow;
+  int PollInterval = PL_GetPollingInterval() > 0 ? PL_GetPollingInterval() : 10;
+
+  for (;;)
+  {
+    //** a closed ring (server gone) or a closed socket ends the session
+    if (PL_WaitForData(1, PollInterval*1000) < 0 || PeerClosed(fd) || !SendConfig(fd, Config.data()))
+      break;
+
+    int NumMAPEvents = PL_NET_MAX_FRAME_RECORDS;
+    PL_GetLongWaveFormStructuresEx2(&NumMAPEvents, Records.data(), &ServerDropped, &MMFDropped,
+      &PollHigh, &PollLow);
+    if (NumMAPEvents == 0 && ServerDropped == 0 && MMFDropped == 0)
+      continue;
+
+    Frame.clear();
+    PL_NetEncodeFrame(Records.data(), NumMAPEvents, ServerDropped, MMFDropped, Frame);
+    if (!PL_NetSendAll(fd, Frame.data(), Frame.size()))
+      break;
+  }
+
+  PL_CloseClient();
+  return 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+  int Port = PL_NET_DEFAULT_PORT;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "p:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'p': Port = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-p port]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  int Listener = socket(AF_INET, SOCK_STREAM, 0);
+  int On = 1;
+  setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &On, sizeof(On));
+  sockaddr_in Addr;
+  memset(&Addr, 0, sizeof(Addr));
+  Addr.sin_family = AF_INET;
+  Addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  Addr.sin_port = htons((unsigned short)Port);
+  if (Listener < 0 || bind(Listener, (sockaddr*)&Addr, sizeof(Addr)) != 0 || listen(Listener, 8) != 0)
+  {
+    perror("PlexNetServer");
+    return 1;
+  }
+
+  //** children are reaped automatically
+  signal(SIGCHLD, SIG_IGN);
+  printf("PlexNetServer: listening on port %d\n", Port);
+  fflush(stdout);
+
+  for (;;)
+  {
+    int fd = accept(Listener, NULL, NULL);
+    if (fd < 0)
+      continue;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &On, sizeof(On));
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+      close(Listener);
+      int Result = ServeClient(fd);
+      close(fd);
+      _exit(Result);
+    }
+    close(fd);
+  }
+}
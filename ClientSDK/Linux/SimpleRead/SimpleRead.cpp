@@ -0,0 +1,80 @@
+//
+//   SimpleRead.cpp
+//
+//   Linux version of the SimpleRead sample: a console-mode app that reads spike
+//   timestamps from the Server and prints a count of timestamps to the console.
+//
+//   Must include Plexon.h and link with the Linux libPlexClient.so.  Run the
+//   SoftServer test program (or another server feeding the shared-memory
+//   ring) first.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//** header file containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+
+//** maximum number of MAP events to be read at one time from the Server
+#define MAX_MAP_EVENTS_PER_READ 500000
+
+
+int main()
+{
+  PL_Event*     pServerEventBuffer;     //** buffer in which the Server will return MAP events
+  int           NumMAPEvents;           //** number of MAP events returned from the Server
+  int           NumSpikeTimestamps;     //** number of MAP events which are spike timestamps
+  int           i;                      //** loop counter
+
+  //** connect to the server
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+
+  //** allocate memory in which the server will return MAP events
+  pServerEventBuffer = (PL_Event*)malloc(sizeof(PL_Event)*MAX_MAP_EVENTS_PER_READ);
+  if (pServerEventBuffer == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    PL_CloseClient();
+    return 1;
+  }
+
+  //** this loop reads from the Server five times per second until the user hits Control-C
+  for (;;)
+  {
+    //** this tells the Server the max number of MAP events that can be returned to us in one read
+    NumMAPEvents = MAX_MAP_EVENTS_PER_READ;
+
+    //** call the Server to get all the MAP events since the last time we called PL_GetTimeStampStructures
+    PL_GetTimeStampStructures(&NumMAPEvents, pServerEventBuffer);
+
+    //** step through the array of MAP events, counting only the spike timestamps
+    NumSpikeTimestamps = 0; //** reset counts
+    for (i = 0; i < NumMAPEvents; i++)
+    {
+      //** is this the timestamp of a sorted spike?
+      if (pServerEventBuffer[i].Type == PL_SingleWFType && //** spike timestamp
+          pServerEventBuffer[i].Unit >= 1 &&               //** 1,2,3,4 = a,b,c,d units
+          pServerEventBuffer[i].Unit <= 4)                 //** unsorted spikes have Unit == 0
+        NumSpikeTimestamps++;
+    }
+
+    //** write the total number of timestamps to the console
+    printf("%d data blocks (%d spike timestamps)\r\n", NumMAPEvents, NumSpikeTimestamps);
+
+    //** yield to other programs for 200 msec before calling the Server again
+    usleep(200000);
+  }
+
+  //** in this sample, we will never get to this point, but this is how we would free the
+  //** allocated memory and disconnect from the Server
+
+  free(pServerEventBuffer);
+  PL_CloseClient();
+
+  return 0;
+}
@@ -0,0 +1,146 @@
+//
+//   SlowHistory.cpp
+//
+//   Console-mode app showing the history store: one copy of it, started with
+//   -w, reads the Server and keeps the last seconds of every continuous
+//   (NIDAQ) channel in the store; any number of other copies read time
+//   windows of it without connecting to the Server, as LFP-triggered analyses
+//   would.  The reader prints, once per second, the span the store holds for
+//   one channel and the mean and range of its newest samples.  The filler
+//   connects with PL_CLIENT_REPLAY, so the store starts with whatever the
+//   Server still holds of the kept span instead of filling up in real time.
+//
+//   Usage: SlowHistory -w [seconds]            fill the store
+//          SlowHistory [channel] [samples]     read one channel
+//
+//   Must include Plexon.h and PlexonShm.h and link with the Linux libPlexClient.so.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+//** maximum number of MAP events to be read at one time from the Server
+#define MAX_MAP_EVENTS_PER_READ 500000
+
+//** maximum number of samples read from one window
+#define MAX_WINDOW_SAMPLES      1000000
+
+
+static int Fill(int Seconds)
+{
+  if (Seconds <= 0)
+    Seconds = PL_HISTORY_DEFAULT_SECONDS;
+
+  //** connect with a replay of the span the store keeps
+  PL_ClientOptions Options;
+  memset(&Options, 0, sizeof(Options));
+  Options.Size = sizeof(Options);
+  Options.Flags = PL_CLIENT_REPLAY;
+  Options.ReplayMillis = Seconds*1000;
+  if (!PL_InitClientEx4(0, &Options))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+  int NIDAQSampleRate, NumNIDAQChannels;
+  PL_GetSlowInfo(&NIDAQSampleRate, &NumNIDAQChannels, NULL);
+  if (NumNIDAQChannels <= 0 || !PL_CreateHistoryStore(NULL, NumNIDAQChannels, Seconds, NULL, 0))
+  {
+    printf("Couldn't create the history store (%d continuous channels)\r\n", NumNIDAQChannels);
+    PL_CloseClient();
+    return 1;
+  }
+  printf("keeping the last %d seconds of %d channels at %d Hz\r\n",
+    Seconds, NumNIDAQChannels, NIDAQSampleRate);
+
+  PL_WaveLong* pServerEventBuffer = (PL_WaveLong*)malloc(sizeof(PL_WaveLong)*MAX_MAP_EVENTS_PER_READ);
+  if (pServerEventBuffer == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    PL_CloseHistoryStore();
+    PL_CloseClient();
+    return 1;
+  }
+
+  //** only continuous data is stored, so skip the spikes and events altogether
+  PL_SelectLanes(PL_LANE_CONTINUOUS);
+  printf("replaying %d records\r\n", PL_GetReplayPending());
+
+  //** store the samples of every read until the server goes away
+  while (PL_WaitForData(1, -1) >= 0)
+  {
+    int NumMAPEvents = MAX_MAP_EVENTS_PER_READ;
+    int ServerDropped, MMFDropped, PollHigh, PollLow;
+    PL_GetLongWaveFormStructuresEx2(&NumMAPEvents, pServerEventBuffer,
+      &ServerDropped, &MMFDropped, &PollHigh, &PollLow);
+    PL_PutHistory(pServerEventBuffer, NumMAPEvents);
+  }
+
+  free(pServerEventBuffer);
+  PL_CloseHistoryStore();
+  PL_CloseClient();
+  return 0;
+}
+
+
+static int Read(int Channel, int WindowSamples)
+{
+  if (!PL_OpenHistoryStore(NULL))
+  {
+    printf("Couldn't open the history store, is SlowHistory -w running?\r\n");
+    return 1;
+  }
+
+  if (WindowSamples <= 0 || WindowSamples > MAX_WINDOW_SAMPLES)
+    WindowSamples = MAX_WINDOW_SAMPLES;
+  short* Samples = (short*)malloc(sizeof(short)*MAX_WINDOW_SAMPLES);
+  if (Samples == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    PL_CloseHistoryStore();
+    return 1;
+  }
+
+  for (;;)
+  {
+    sleep(1);
+    unsigned long long First, End, Missing;
+    double Ticks;
+    if (!PL_GetHistoryRange(Channel, &First, &End, &Ticks, &Missing))
+    {
+      printf("AD%d: no samples\r\n", Channel);
+      continue;
+    }
+
+    //** the window of the newest samples: sample times are Ticks apart
+    unsigned long long Length = (unsigned long long)(WindowSamples*Ticks);
+    unsigned long long Start = End > Length ? End - Length : 0;
+    unsigned long long WindowFirst;
+    int n = PL_GetHistory(Channel, Start, End, MAX_WINDOW_SAMPLES, Samples, &WindowFirst);
+
+    double Sum = 0;
+    short Min = n ? Samples[0] : 0, Max = Min;
+    for (int i = 0; i < n; i++)
+    {
+      Sum += Samples[i];
+      if (Samples[i] < Min) Min = Samples[i];
+      if (Samples[i] > Max) Max = Samples[i];
+    }
+    printf("AD%d: holds t=%llu to %llu, %llu missing; %d samples from t=%llu, mean %.1f, range %d to %d\r\n",
+      Channel, First, End, Missing, n, WindowFirst, n ? Sum/n : 0.0, Min, Max);
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "-w") == 0)
+    return Fill(argc > 2 ? atoi(argv[2]) : 0);
+  return Read(argc > 1 ? atoi(argv[1]) : 0, argc > 2 ? atoi(argv[2]) : 1000);
+}
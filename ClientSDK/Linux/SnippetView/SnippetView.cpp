@@ -0,0 +1,115 @@
+//
+//   SnippetView.cpp
+//
+//   Console-mode app showing the snippet store: one copy of it, started with
+//   -w, reads the Server and keeps the latest waveforms of every unit in the
+//   store; any number of other copies display them without connecting to the
+//   Server, as a waveform display would.  The display prints, once per
+//   second, how many waveforms each unit of one channel has had and the mean
+//   peak-to-peak amplitude of the latest ones.
+//
+//   Usage: SnippetView -w [depth]      fill the store
+//          SnippetView [channel]       display one channel
+//
+//   Must include Plexon.h and PlexonShm.h and link with the Linux libPlexClient.so.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonShm.h"
+
+//** maximum number of MAP events to be read at one time from the Server
+#define MAX_MAP_EVENTS_PER_READ 500000
+
+
+static int Fill(int Depth)
+{
+  if (!PL_InitClientEx3(0, NULL, NULL))
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+  int NumDSPChannels, NPointsWave, NPointsPreThr, GainMult;
+  PL_GetGlobalPars(&NumDSPChannels, &NPointsWave, &NPointsPreThr, &GainMult);
+  if (!PL_CreateSnippetStore(NULL, NumDSPChannels, Depth))
+  {
+    printf("Couldn't create the snippet store\r\n");
+    PL_CloseClient();
+    return 1;
+  }
+  printf("keeping the latest waveforms of %d channels\r\n", NumDSPChannels);
+
+  PL_WaveLong* pServerEventBuffer = (PL_WaveLong*)malloc(sizeof(PL_WaveLong)*MAX_MAP_EVENTS_PER_READ);
+  if (pServerEventBuffer == NULL)
+  {
+    printf("Couldn't allocate memory, I can't continue!\r\n");
+    PL_CloseSnippetStore();
+    PL_CloseClient();
+    return 1;
+  }
+
+  //** store the spikes of every read until the server goes away
+  while (PL_WaitForData(1, -1) >= 0)
+  {
+    int NumMAPEvents = MAX_MAP_EVENTS_PER_READ;
+    int ServerDropped, MMFDropped, PollHigh, PollLow;
+    PL_GetLongWaveFormStructuresEx2(&NumMAPEvents, pServerEventBuffer,
+      &ServerDropped, &MMFDropped, &PollHigh, &PollLow);
+    PL_PutSnippets(pServerEventBuffer, NumMAPEvents);
+  }
+
+  free(pServerEventBuffer);
+  PL_CloseSnippetStore();
+  PL_CloseClient();
+  return 0;
+}
+
+
+static int Display(int Channel)
+{
+  if (!PL_OpenSnippetStore(NULL))
+  {
+    printf("Couldn't open the snippet store, is SnippetView -w running?\r\n");
+    return 1;
+  }
+
+  static PL_WaveLong Snippets[PL_SNIPPET_DEFAULT_DEPTH];
+  for (;;)
+  {
+    sleep(1);
+    printf("SPK%d:", Channel);
+    for (int Unit = 0; Unit < PL_SNIPPET_UNITS; Unit++)
+    {
+      unsigned long long Total;
+      int n = PL_GetLatestSnippets(Channel, Unit, PL_SNIPPET_DEFAULT_DEPTH, Snippets, &Total);
+
+      //** mean peak-to-peak amplitude of the waveforms taken
+      double Sum = 0;
+      for (int i = 0; i < n; i++)
+      {
+        short Min = Snippets[i].WaveForm[0], Max = Snippets[i].WaveForm[0];
+        for (int k = 1; k < Snippets[i].NumberOfDataWords; k++)
+        {
+          if (Snippets[i].WaveForm[k] < Min) Min = Snippets[i].WaveForm[k];
+          if (Snippets[i].WaveForm[k] > Max) Max = Snippets[i].WaveForm[k];
+        }
+        Sum += Max - Min;
+      }
+      printf(" %c %llu (p-p %.0f)", Unit ? 'a' + Unit - 1 : 'u', Total, n ? Sum/n : 0.0);
+    }
+    printf("\r\n");
+  }
+}
+
+
+int main(int argc, char* argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "-w") == 0)
+    return Fill(argc > 2 ? atoi(argv[2]) : 0);
+  return Display(argc > 1 ? atoi(argv[1]) : 1);
+}
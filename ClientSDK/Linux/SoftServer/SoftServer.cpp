@@ -0,0 +1,287 @@
+//
+//   SoftServer.cpp
+//
+//   Test server for the Linux shared-memory client library.  Creates the
+//   shared-memory ring and feeds it with synthetic MAP data: sorted and
+//   unsorted spikes with waveforms on every DSP channel, strobed external
+//   events and, optionally, blocks of continuous (NIDAQ) samples.  Clients
+//   built against Plexon.h and the Linux libPlexClient.so can read it exactly
+//   as they would read a live server.
+//
+//   Usage: SoftServer [-n shmname] [-c spikechannels] [-r spikerate] [-s slowchannels]
+//                     [-f slowfreq] [-e eventinterval_ms] [-p pollinterval_ms]
+//                     [-q capacity] [-l capacity] [-t seconds] [-g seconds] [-d percent] [-v]
+//
+//   With -v, the connected clients and the lag of the slowest one are printed
+//   once per second.  With -g, the thresholds of all channels are changed
+//   every given number of seconds, which bumps the configuration generation.
+//   With -d, the given percentage of the spikes of the last DSP channel is
+//   dropped and reported as server drops, like an overflowing electrode.
+//   With -l, continuous samples go to a lane of their own with the given
+//   capacity (see PL_ServerCreateEx).
+//
+
+#include <algorithm>
+#include <math.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../../include/Plexon.h"
+#include "../../include/PlexServer.h"
+#include "../../include/PlexonShm.h"
+
+
+static volatile sig_atomic_t g_Stop = 0;
+
+static void OnSignal(int)
+{
+  g_Stop = 1;
+}
+
+
+//** fill in the 40-bit timestamp of a record
+static void SetTimeStamp(PL_WaveLong* rec, uint64_t ts)
+{
+  rec->UpperTS = (unsigned char)(ts >> 32);
+  rec->TimeStamp = (PL_UINT32)ts;
+}
+
+
+//** record ordering for the merge of all channels within one poll
+static bool EarlierThan(const PL_WaveLong& a, const PL_WaveLong& b)
+{
+  uint64_t ta = ((uint64_t)a.UpperTS << 32) | a.TimeStamp;
+  uint64_t tb = ((uint64_t)b.UpperTS << 32) | b.TimeStamp;
+  return ta < tb;
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char*   ShmName = NULL;       //** shared-memory object name, NULL for the default
+  int           NumSpikeChannels = 16;
+  double        SpikeRate = 50.0;     //** spikes/sec per channel
+  int           NumSlowChannels = 0;
+  int           SlowFrequency = 1000; //** continuous samples/sec per channel
+  int           EventInterval = 1000; //** msec between strobed events, 0 for none
+  int           PollInterval = 10;    //** msec between publishes
+  int           Capacity = 0;         //** ring capacity, 0 for the default
+  int           ContinuousCapacity = 0; //** capacity of the continuous lane, 0 for none
+  int           Seconds = 0;          //** run time, 0 to run until Control-C
+  int           Verbose = 0;          //** print client status once per second
+  int           ConfigInterval = 0;   //** seconds between threshold changes, 0 for none
+  double        DropPercent = 0;      //** spikes of the last channel dropped by the "server"
+  int           opt;
+
+  while ((opt = getopt(argc, argv, "n:c:r:s:f:e:p:q:l:t:g:d:v")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n': ShmName = optarg; break;
+      case 'c': NumSpikeChannels = atoi(optarg); break;
+      case 'r': SpikeRate = atof(optarg); break;
+      case 's': NumSlowChannels = atoi(optarg); break;
+      case 'f': SlowFrequency = atoi(optarg); break;
+      case 'e': EventInterval = atoi(optarg); break;
+      case 'p': PollInterval = atoi(optarg); break;
+      case 'q': Capacity = atoi(optarg); break;
+      case 'l': ContinuousCapacity = atoi(optarg); break;
+      case 't': Seconds = atoi(optarg); break;
+      case 'g': ConfigInterval = atoi(optarg); break;
+      case 'd': DropPercent = atof(optarg); break;
+      case 'v': Verbose = 1; break;
+      default:
+        fprintf(stderr, "usage: %s [-n shmname] [-c spikechannels] [-r spikerate] "
+                "[-s slowchannels] [-f slowfreq] [-e eventinterval_ms] "
+                "[-p pollinterval_ms] [-q capacity] [-l capacity] [-t seconds] [-g seconds] [-d percent] [-v]\n", argv[0]);
+        return 1;
+    }
+  }
+  if (PollInterval < 1)
+    PollInterval = 1;
+
+  PL_ServerInfo Info;
+  PL_ServerInitInfo(&Info);
+  Info.PollingInterval = PollInterval;
+  Info.NumSpikeChannels = NumSpikeChannels;
+  Info.NumSlowChannels = NumSlowChannels;
+  Info.SlowFrequency = SlowFrequency;
+
+  const int     MAPSampleRate = 1000000/Info.TimeStampTick;
+  const int     TicksPerPoll = MAPSampleRate/1000*PollInterval;
+  const int     PollsPerSecond = std::max(1, 1000/PollInterval);       //** at least one with -p over 1000
+  const int     PollsPerConfig = std::max(1, ConfigInterval*1000/PollInterval);
+  const int     TicksPerSlowSample = SlowFrequency > 0 ? MAPSampleRate/SlowFrequency : 0;
+
+  //** samples are stamped a whole number of ticks apart
+  if (NumSlowChannels > 0 && (SlowFrequency <= 0 || MAPSampleRate % SlowFrequency != 0))
+  {
+    fprintf(stderr, "-f %d must divide the timestamp rate of %d Hz\n", SlowFrequency, MAPSampleRate);
+    return 1;
+  }
+
+  if (!PL_ServerCreateEx(ShmName, Capacity, ContinuousCapacity, &Info))
+  {
+    fprintf(stderr, "couldn't create the shared-memory ring\n");
+    return 1;
+  }
+  signal(SIGINT, OnSignal);
+  signal(SIGTERM, OnSignal);
+  printf("SoftServer: %d spike channels at %.1f Hz, %d slow channels at %d Hz, polling every %d ms\n",
+    NumSpikeChannels, SpikeRate, NumSlowChannels, SlowFrequency, PollInterval);
+
+  //** one template waveform per unit (0 = unsorted)
+  short Templates[5][MAX_WF_LENGTH_LONG];
+  for (int unit = 0; unit < 5; unit++)
+    for (int i = 0; i < Info.NPointsWave; i++)
+      Templates[unit][i] = (short)(-(400 + 150*unit)*exp(-0.5*pow((i - Info.NPointsPreThr)/2.0, 2)) +
+                                   (150 + 50*unit)*exp(-0.5*pow((i - Info.NPointsPreThr - 6)/4.0, 2)));
+
+  //** publish the sort setup: a threshold and the templates of units 1 to 4 on every channel
+  PL_ConfigSnapshot* Config = new PL_ConfigSnapshot;
+  PL_ServerGetConfig(Config);
+  for (int ch = 0; ch < NumSpikeChannels && ch < PL_CONFIG_MAX_CHANNELS; ch++)
+  {
+    Config->Threshold[ch] = -250;
+    Config->NumUnits[ch] = 4;
+    for (int unit = 1; unit <= PL_CONFIG_MAX_UNITS; unit++)
+      for (int i = 0; i < Info.NPointsWave && i < PL_CONFIG_TEMPLATE_POINTS; i++)
+        Config->Templates[ch][unit - 1][i] = Templates[unit][i];
+  }
+  PL_ServerSetConfig(Config);
+
+  std::vector<PL_WaveLong> Batch;
+  std::vector<PL_WaveLong> UserEvents(4*PL_USER_EVENT_MAX_BATCH);
+  uint64_t      Now = 0;                //** MAP timestamp at the start of the current poll
+  uint64_t      NextEvent = 0;          //** MAP timestamp of the next strobed event
+  uint64_t      NextSlowSample = 0;     //** MAP timestamp of the next continuous sample
+  uint64_t      SlowSampleIndex = 0;
+  unsigned      StrobeWord = 0;
+  uint64_t      Published = 0;
+  double        SpikesPerPoll = SpikeRate*PollInterval/1000.0;
+  timespec      Wake;
+
+  srand(1);
+  clock_gettime(CLOCK_MONOTONIC, &Wake);
+
+  //** the first record tells clients that acquisition has started
+  PL_WaveLong Start;
+  memset(&Start, 0, sizeof(Start));
+  Start.Type = PL_ExtEventType;
+  Start.Channel = PL_StartExtChannel;
+  Batch.push_back(Start);
+
+  for (int poll = 0; !g_Stop && (Seconds == 0 || poll < Seconds*1000/PollInterval); poll++)
+  {
+    PL_WaveLong rec;
+
+    //** the MAP clock reads Now at the scheduled start of this poll
+    PL_ServerClockSample(Now, (unsigned long long)Wake.tv_sec*1000000000ull + Wake.tv_nsec);
+
+    //** spikes: a Poisson-ish count per channel, uniformly spread over the poll interval
+    for (int ch = 1; ch <= NumSpikeChannels; ch++)
+    {
+      int count = (int)SpikesPerPoll;
+      if (rand() < (SpikesPerPoll - count)*RAND_MAX)
+        count++;
+      for (int k = 0; k < count; k++)
+      {
+        memset(&rec, 0, sizeof(rec));
+        rec.Type = PL_SingleWFType;
+        rec.Channel = (short)ch;
+        rec.Unit = (short)(rand() % 5);
+        rec.NumberOfDataWords = (char)Info.NPointsWave;
+        SetTimeStamp(&rec, Now + rand() % TicksPerPoll);
+        if (ch == NumSpikeChannels && rand() < DropPercent/100.0*RAND_MAX)
+        {
+          PL_ServerAddDroppedEx(PL_SingleWFType, ch, 1, ((uint64_t)rec.UpperTS << 32) | rec.TimeStamp);
+          continue;
+        }
+        for (int i = 0; i < Info.NPointsWave; i++)
+          rec.WaveForm[i] = Templates[rec.Unit][i] + (short)(rand() % 41 - 20);
+        Batch.push_back(rec);
+      }
+    }
+
+    //** strobed external events
+    while (EventInterval > 0 && NextEvent < Now + TicksPerPoll)
+    {
+      memset(&rec, 0, sizeof(rec));
+      rec.Type = PL_ExtEventType;
+      rec.Channel = PL_StrobedExtChannel;
+      rec.Unit = (short)(StrobeWord++ & 0x7fff);
+      SetTimeStamp(&rec, NextEvent);
+      Batch.push_back(rec);
+      NextEvent += (uint64_t)EventInterval*MAPSampleRate/1000;
+    }
+
+    //** continuous samples, in blocks of up to MAX_WF_LENGTH_LONG samples per channel
+    while (NumSlowChannels > 0 && TicksPerSlowSample > 0 && NextSlowSample < Now + TicksPerPoll)
+    {
+      int n = (int)((Now + TicksPerPoll - NextSlowSample + TicksPerSlowSample - 1)/TicksPerSlowSample);
+      if (n > MAX_WF_LENGTH_LONG)
+        n = MAX_WF_LENGTH_LONG;
+      for (int ch = 0; ch < NumSlowChannels; ch++)
+      {
+        memset(&rec, 0, sizeof(rec));
+        rec.Type = PL_ADDataType;
+        rec.Channel = (short)ch;
+        rec.NumberOfDataWords = (char)n;
+        SetTimeStamp(&rec, NextSlowSample);
+        for (int i = 0; i < n; i++)
+          rec.WaveForm[i] = (short)(1000*sin(2*M_PI*(ch + 1)*(double)(SlowSampleIndex + i)/SlowFrequency));
+        Batch.push_back(rec);
+      }
+      SlowSampleIndex += n;
+      NextSlowSample += (uint64_t)n*TicksPerSlowSample;
+    }
+
+    //** like an acquisition system, publish the records of a poll once it has elapsed;
+    //** wait on an absolute schedule so the data rate does not drift
+    Wake.tv_nsec += PollInterval*1000000L;
+    while (Wake.tv_nsec >= 1000000000L)
+    {
+      Wake.tv_nsec -= 1000000000L;
+      Wake.tv_sec++;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Wake, NULL);
+
+    //** user events sent by clients go into this publish; the stable sort keeps
+    //** each batch of them in order
+    int NumUserEvents = PL_ServerTakeUserEvents(UserEvents.data(), (int)UserEvents.size(),
+                                                Now, Now + TicksPerPoll - 1);
+    Batch.insert(Batch.end(), UserEvents.begin(), UserEvents.begin() + NumUserEvents);
+
+    std::stable_sort(Batch.begin(), Batch.end(), EarlierThan);
+    Published += PL_ServerPutRecords(Batch.data(), (int)Batch.size());
+    Batch.clear();
+    Now += TicksPerPoll;
+
+    if (ConfigInterval > 0 && (poll + 1) % PollsPerConfig == 0)
+    {
+      for (int ch = 0; ch < NumSpikeChannels && ch < PL_CONFIG_MAX_CHANNELS; ch++)
+        Config->Threshold[ch] = -200 - rand() % 100;
+      PL_ServerSetConfig(Config);
+    }
+
+    if (Verbose && (poll + 1) % PollsPerSecond == 0)
+    {
+      int SlowestPid;
+      long long MaxLag = PL_ServerGetMaxLag(&SlowestPid);
+      printf("t=%llus: %llu records, %d clients, max lag %lld records (pid %d)\n",
+        (unsigned long long)(Now*Info.TimeStampTick/1000000), (unsigned long long)Published,
+        PL_ServerGetClients(NULL, 0), MaxLag, SlowestPid);
+    }
+  }
+
+  printf("SoftServer: published %llu records\n", (unsigned long long)Published);
+  PL_ServerClose();
+  delete Config;
+  return 0;
+}
@@ -0,0 +1,96 @@
+//
+//   TimeStampRead.cpp
+//
+//   Linux version of the TimeStampRead sample: a console-mode app that reads
+//   spike timestamps from the Server and prints the individual timestamps to
+//   the console.  Uses the PL_Client object from PlexonClient.h, which owns the
+//   connection and a pre-faulted read buffer that grows with the backlog
+//   instead of a fixed MAX_MAP_EVENTS_PER_READ malloc.
+//
+//   Usage: TimeStampRead [-l]      (-l locks the read buffer in RAM)
+//
+//   Must include Plexon.h and PlexonClient.h and link with the Linux libPlexClient.so.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+//** header files containing the Plexon APIs (link with libPlexClient.so)
+#include "../../include/Plexon.h"
+#include "../../include/PlexonClient.h"
+
+
+int main(int argc, char* argv[])
+{
+  int           NumMAPEvents;           //** number of MAP events returned from the Server
+  int           SpikeChannel;           //** DSP channel on which a spike timestamp occurred
+  char          SpikeUnit;              //** a,b,c or d
+  unsigned      SpikeTime;              //** spike timestamp
+  int           MAPSampleRate;          //** samples/sec for MAP channels
+  int           MAPEventIndex;          //** loop counter
+  unsigned      Flags = PL_BUFFER_HUGEPAGES;
+
+  if (argc > 1 && strcmp(argv[1], "-l") == 0)
+    Flags |= PL_BUFFER_LOCK;
+
+  //** connect to the server; the client disconnects when it goes out of scope
+  PL_Client Client(0, Flags);
+  if (!Client.IsConnected())
+  {
+    printf("Couldn't connect to the server, is it running?\r\n");
+    return 1;
+  }
+  printf("read buffer: %zu records%s%s\r\n", Client.Buffer().Capacity(),
+    Client.Buffer().IsHuge() ? ", huge pages" : "", Client.Buffer().IsLocked() ? ", locked" : "");
+
+  //** get the MAP sampling rate (spike timestamps); PL_GetTimeStampTick returns
+  //** the timestamp resolution in microseconds
+  MAPSampleRate = 1000000/PL_GetTimeStampTick();
+
+  //** this loop reads from the Server five times per second until the user hits Control-C
+  for (;;)
+  {
+    printf("reading from server\r\n");
+
+    //** get all the MAP events since the last read
+    NumMAPEvents = Client.Read();
+    const PL_WaveLong* pServerEventBuffer = Client.Records();
+
+    //** step through the array of MAP events, displaying only the spike timestamps
+    for (MAPEventIndex = 0; MAPEventIndex < NumMAPEvents; MAPEventIndex++)
+    {
+      //** is this the timestamp of a sorted spike? (unsorted spikes have Unit == 0)
+      if (pServerEventBuffer[MAPEventIndex].Type == PL_SingleWFType &&
+          pServerEventBuffer[MAPEventIndex].Unit >= 1 &&
+          pServerEventBuffer[MAPEventIndex].Unit <= 4)
+      {
+        SpikeChannel = pServerEventBuffer[MAPEventIndex].Channel; //** 1-based DSP channel number
+        SpikeUnit = 'a' + (pServerEventBuffer[MAPEventIndex].Unit-1); //** map 1,2,3,4 -> a,b,c,d
+        SpikeTime = pServerEventBuffer[MAPEventIndex].TimeStamp;
+        printf("SPK%d%c t=%f\r\n", SpikeChannel, SpikeUnit, (float)SpikeTime/(float)MAPSampleRate);
+      }
+    }
+
+    //** name the channels that are losing data
+    if (Client.ServerDropped() > 0 || Client.MMFDropped() > 0)
+    {
+      int Channels[PL_SUB_MAX_CHANNEL];
+      int NumChannels = PL_GetDroppedChannels(PL_SingleWFType, Channels, PL_SUB_MAX_CHANNEL);
+      printf("dropped %d (server) + %d (mmf) records; spike channels with drops:",
+        Client.ServerDropped(), Client.MMFDropped());
+      for (int i = 0; i < NumChannels && i < PL_SUB_MAX_CHANNEL; i++)
+      {
+        PL_DropStats Stats;
+        PL_GetDropStats(PL_SingleWFType, Channels[i], &Stats);
+        printf(" %d (%llu)", Channels[i], Stats.ServerDropped + Stats.MMFDropped);
+      }
+      printf("\r\n");
+    }
+
+    //** yield to other programs for 200 msec before calling the Server again
+    usleep(200000);
+  }
+
+  return 0;
+}
@@ -0,0 +1,219 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PlexServer.h - server-side API for feeding the Linux shared-memory
+//                implementation of the Plexon client API
+//
+// The Linux PlexClient library (ClientSDK/Linux) implements the Plexon.h
+// client calls on top of a POSIX shared-memory ring of PL_WaveLong records.
+// A server process (a real acquisition front end, a relay, or the SoftServer
+// test program) creates the ring with PL_ServerCreate and publishes data with
+// PL_ServerPutRecords; clients connect with PL_InitClientEx3 as usual.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef _PLEXSERVER_H_INCLUDED
+#define _PLEXSERVER_H_INCLUDED
+
+#include "Plexon.h"
+
+
+struct PL_ConfigSnapshot;   // PlexonShm.h
+
+
+// name of the shared-memory object used when none is given; clients use the
+// PLEXON_SHM_NAME environment variable, if set, instead of this name
+#define PL_SERVER_DEFAULT_NAME      "/PlexonServer"
+
+// default ring capacity in records (must be a power of two)
+#define PL_SERVER_DEFAULT_CAPACITY  (1 << 18)
+
+// maximum number of clients connected at the same time
+#define PL_SERVER_MAX_CLIENTS       (64)
+
+
+//
+// Static server parameters, returned to clients by PL_GetTimeStampTick,
+// PL_GetGlobalParsEx, PL_GetSlowInfo and friends
+//
+struct PL_ServerInfo
+{
+    int     TimeStampTick;      // timestamp resolution in microseconds (25 = 40 kHz)
+    int     PollingInterval;    // server polling interval in milliseconds
+    int     LongWaveMode;       // 1 if the server uses long waves
+    int     NumSpikeChannels;   // number of DSP channels
+    int     NPointsWave;        // number of points in a spike waveform
+    int     NPointsPreThr;      // number of pre-threshold points
+    int     GainMult;           // gain multiplier
+    int     MaxWFLength;        // max waveform length (MAX_WF_LENGTH_LONG in long wave mode)
+    int     NumSlowChannels;    // number of continuous (NIDAQ) channels
+    int     SlowFrequency;      // continuous sampling rate in Hz
+};
+
+
+//
+// Read position of one connected client, returned by PL_ServerGetClients
+//
+struct PL_ServerClientInfo
+{
+    int         Pid;            // client process id
+    int         Type;           // client type passed to PL_InitClient*
+    long long   Lag;            // records published but not yet read by the client, in all lanes
+    long long   MMFDropped;     // records overwritten before the client read them
+    long long   ServerDropped;  // server-side drops reported to the client
+};
+
+
+// PL_ServerInitInfo - fill a PL_ServerInfo with typical MAP defaults
+//      (40 kHz timestamps, 32-point waveforms, long wave mode)
+extern "C" void     WINAPI PL_ServerInitInfo(PL_ServerInfo* info);
+
+
+// PL_ServerCreate - create the shared-memory ring
+// In:
+//      name -- shared-memory object name, or NULL for PL_SERVER_DEFAULT_NAME
+//      capacity -- ring capacity in records (power of two), or 0 for
+//                  PL_SERVER_DEFAULT_CAPACITY
+//      info -- server parameters published to clients
+// Returns:
+//      1 if successful, 0 otherwise
+// Effect:
+//      Creates (or re-creates) the named shared-memory object. Only one
+//      server may be active per process.
+extern "C" int      WINAPI PL_ServerCreate(const char* name, int capacity,
+                                           const PL_ServerInfo* info);
+
+
+// PL_ServerCreateEx - create the shared-memory ring with a separate continuous lane
+// In:
+//      name, capacity, info -- as for PL_ServerCreate; capacity is that of
+//                              the events lane (spikes and events)
+//      continuousCapacity -- capacity in records (power of two) of the lane
+//                            for continuous (PL_ADDataType) records, or 0 for
+//                            none, which makes this PL_ServerCreate
+// Returns:
+//      1 if successful, 0 otherwise
+// Effect:
+//      The two lanes are independent rings: a burst of continuous data can
+//      neither overwrite nor delay spikes and events, and clients that read
+//      only one lane are only woken by its publishes (see PL_SelectLanes).
+//      Clients reading both still get all records in timestamp order.
+extern "C" int      WINAPI PL_ServerCreateEx(const char* name, int capacity, int continuousCapacity,
+                                             const PL_ServerInfo* info);
+
+
+// PL_ServerPutRecords - publish records to all clients
+// In:
+//      records -- array of n records, in timestamp order
+//      n -- number of records
+// Returns:
+//      number of records published
+// Effect:
+//      Copies the records into the ring, stamps the poll time that clients
+//      receive as pollhigh/polllow and makes the records visible to clients.
+//      The server never waits for clients; a client that falls more than
+//      the ring capacity behind loses the oldest records (mmfdropped).
+extern "C" int      WINAPI PL_ServerPutRecords(const PL_WaveLong* records, int n);
+
+
+// PL_ServerClockSample - tell clients when a MAP timestamp was acquired
+// In:
+//      ts -- 40-bit MAP timestamp
+//      hostNanos -- CLOCK_MONOTONIC time in ns at which the MAP clock read
+//                   ts, or 0 for now
+// Effect:
+//      Adds a point to the clock samples clients fit PL_MapTimeToHost to.
+//      Call it once per poll with the MAP time the acquisition hardware
+//      reported.  A server that never calls it gets one sample per
+//      PL_ServerPutRecords call instead, pairing the timestamp of the last
+//      record with the publish time, which includes the server's latency.
+extern "C" void     WINAPI PL_ServerClockSample(unsigned long long ts, unsigned long long hostNanos);
+
+
+// PL_ServerAddDropped - count records the server could not deliver
+// Effect:
+//      Adds n to the count that clients receive as serverdropped
+extern "C" void     WINAPI PL_ServerAddDropped(int n);
+
+
+// PL_ServerAddDroppedEx - count records the server could not deliver, per channel
+// In:
+//      type, channel -- record type and channel of the dropped records
+//      n -- number of records dropped
+//      ts -- MAP timestamp of the last of them, or 0 if unknown
+// Effect:
+//      Same as PL_ServerAddDropped, and also lets clients attribute the drops
+//      with PL_GetDropStats.  Drops of types or channels above PL_SUB_MAX_TYPE
+//      and PL_SUB_MAX_CHANNEL are counted but not attributed.
+extern "C" void     WINAPI PL_ServerAddDroppedEx(int type, int channel, int n, unsigned long long ts);
+
+
+// PL_ServerTakeUserEvents - take the user events sent by clients
+// In:
+//      nmax -- number of entries in records, at least PL_USER_EVENT_MAX_BATCH
+//              (PlexonShm.h) so that any batch fits
+//      first, last -- MAP timestamps of the first and last record of the
+//                     publish the events will be merged into
+// Out:
+//      records -- PL_ExtEventType records, batch by batch
+// Returns:
+//      number of records, 0 if nmax is too small
+// Effect:
+//      Takes every batch queued by PL_SendUserEvent* whose events are all due
+//      by last, in the order the batches were sent; events without a requested
+//      timestamp get last, earlier ones are raised to first.  A batch is never
+//      split: one that does not fit in nmax stays queued.  Merge the records
+//      into the publish with a stable sort by timestamp to keep each batch in
+//      order.
+extern "C" int      WINAPI PL_ServerTakeUserEvents(PL_WaveLong* records, int nmax,
+                                                   unsigned long long first,
+                                                   unsigned long long last);
+
+
+// PL_ServerGetClients - report the read position of every connected client
+// In:
+//      nmax -- number of entries in clients
+// Out:
+//      clients -- one entry per connected client, may be NULL if nmax is 0
+// Returns:
+//      number of connected clients (may exceed nmax)
+// Effect:
+//      Every client reads the same ring through its own cursor; this call
+//      reads the cursors and frees those left behind by crashed clients.
+extern "C" int      WINAPI PL_ServerGetClients(PL_ServerClientInfo* clients, int nmax);
+
+
+// PL_ServerGetMaxLag - lag of the slowest connected client
+// Out:
+//      *pid -- process id of the slowest client (0 if none), may be NULL
+// Returns:
+//      number of records the slowest client has yet to read; a lag above
+//      the ring capacity means that client is losing data
+extern "C" long long WINAPI PL_ServerGetMaxLag(int* pid);
+
+
+// PL_ServerGetConfig - get the configuration published to clients
+// Out:
+//      config - the current configuration (see PlexonShm.h); PL_ServerCreate
+//               fills it from its info argument and default channel settings
+// Returns:
+//      1 if successful, 0 if there is no ring
+extern "C" int      WINAPI PL_ServerGetConfig(PL_ConfigSnapshot* config);
+
+
+// PL_ServerSetConfig - publish a new configuration to clients
+// In:
+//      config - the new configuration; its Generation is ignored
+// Returns:
+//      the new generation, or 0 if there is no ring
+// Effect:
+//      Replaces the whole configuration atomically as seen by clients and
+//          bumps the generation, so cached client snapshots are refreshed.
+//          Typically called after PL_ServerGetConfig and a few changes.
+extern "C" unsigned long long WINAPI PL_ServerSetConfig(const PL_ConfigSnapshot* config);
+
+
+// PL_ServerClose - close and remove the shared-memory ring
+extern "C" void     WINAPI PL_ServerClose();
+
+
+#endif
@@ -2,6 +2,25 @@
 #define _PLEXON_H_INCLUDED
 
 
+#ifndef _WIN32
+// Non-Windows builds (see ClientSDK/Linux) have no <windows.h>, so supply
+// the few Win32 names used below.
+#ifndef WINAPI
+#define WINAPI
+#endif
+typedef void*           HWND;
+typedef unsigned short  WORD;
+#ifndef WM_USER
+#define WM_USER         (0x0400)
+#endif
+// unsigned long is 64 bits on LP64 systems; keep TimeStamp 32 bits wide so
+// that PL_Event stays 16 bytes and PL_WaveLong stays 256 bytes
+typedef unsigned int    PL_UINT32;
+#else
+typedef unsigned long   PL_UINT32;
+#endif
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Plexon Client API Definitions
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,7 +56,7 @@ struct PL_Event
     char    NumberOfBlocksInRecord;     // reserved   
     char    BlockNumberInRecord;        // reserved 
     unsigned char    UpperTS;           // Upper 8 bits of the 40-bit timestamp
-    unsigned long    TimeStamp;         // Lower 32 bits of the 40-bit timestamp
+    PL_UINT32        TimeStamp;         // Lower 32 bits of the 40-bit timestamp
     short   Channel;                    // Channel that this came from, or Event number
     short   Unit;                       // Unit classification, or Event strobe value
     char    DataType;                   // reserved
@@ -56,7 +75,7 @@ struct PL_Wave
     char    NumberOfBlocksInRecord;     // reserved   
     char    BlockNumberInRecord;        // reserved 
     unsigned char    UpperTS;           // Upper 8 bits of the 40-bit timestamp
-    unsigned long    TimeStamp;         // Lower 32 bits of the 40-bit timestamp
+    PL_UINT32        TimeStamp;         // Lower 32 bits of the 40-bit timestamp
     short   Channel;                    // Channel that this came from, or Event number
     short   Unit;                       // Unit classification, or Event strobe value
     char    DataType;                   // reserved
@@ -75,7 +94,7 @@ struct PL_WaveLong
     char    NumberOfBlocksInRecord;     // reserved   
     char    BlockNumberInRecord;        // reserved 
     unsigned char    UpperTS;           // Upper 8 bits of the 40-bit timestamp
-    unsigned long    TimeStamp;         // Lower 32 bits of the 40-bit timestamp
+    PL_UINT32        TimeStamp;         // Lower 32 bits of the 40-bit timestamp
     short   Channel;                    // Channel that this came from, or Event number
     short   Unit;                       // Unit classification, or Event strobe value
     char    DataType;                   // reserved
@@ -534,7 +553,7 @@ struct PL_DataBlockHeader
 {
     short   Type;                       // Data type; 1=spike, 4=Event, 5=continuous
     unsigned short   UpperByteOf5ByteTimestamp; // Upper 8 bits of the 40 bit timestamp
-    unsigned long    TimeStamp;                 // Lower 32 bits of the 40 bit timestamp
+    PL_UINT32        TimeStamp;                 // Lower 32 bits of the 40 bit timestamp
     short   Channel;                    // Channel number
     short   Unit;                       // Sorted unit number; 0=unsorted
     short   NumberOfWaveforms;          // Number of waveforms in the data to folow, usually 0 or 1
@@ -0,0 +1,266 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PlexonAsync.h - C++20 coroutine layer over the Plexon client API
+//
+// Header only; requires a C++20 compiler and the usual PlexClient library.
+// One PL_AsyncClient reads the server on one thread into one shared buffer
+// and hands each batch to any number of coroutines, each of which waits for
+// the records it is interested in:
+//
+//      PL_AsyncTask CountSpikes(PL_AsyncClient& client)
+//      {
+//          PL_EventFilter spikes;
+//          spikes.TypeMask = 1 << PL_SingleWFType;
+//          while (PL_AsyncBatch batch = co_await client.NextBatch(spikes))
+//              for (const PL_WaveLong& spike : batch)
+//                  ...
+//      }
+//
+//      PL_AsyncClient client;          // after PL_InitClientEx3
+//      CountSpikes(client);            // runs until its first co_await
+//      client.Run();                   // reads and dispatches until Stop()
+//
+// All coroutines are resumed on the thread that calls Run(), one after the
+// other.  A batch is only valid until the coroutine that received it
+// co_awaits again.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef _PLEXONASYNC_H_INCLUDED
+#define _PLEXONASYNC_H_INCLUDED
+
+#include <atomic>
+#include <climits>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <vector>
+
+#include "Plexon.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include "PlexonShm.h"
+#endif
+
+
+//
+// Selects the records a coroutine waits for.  A record matches if its Type
+// bit is set in TypeMask, its Channel is in [FirstChannel, LastChannel] and,
+// for spikes, its Unit bit is set in UnitMask.
+//
+struct PL_EventFilter
+{
+    unsigned int    TypeMask = ~0u;             // bit (1 << Type) for each record type wanted
+    int             FirstChannel = 0;
+    int             LastChannel = INT_MAX;
+    unsigned int    UnitMask = ~0u;             // bit (1 << Unit) for each spike unit wanted
+
+    bool Matches(const PL_WaveLong& rec) const
+    {
+        unsigned type = (unsigned char)rec.Type;
+        if (type >= 32 || !(TypeMask & (1u << type)) ||
+            rec.Channel < FirstChannel || rec.Channel > LastChannel)
+            return false;
+        unsigned unit = (unsigned short)rec.Unit;
+        return type != PL_SingleWFType || (unit < 32 && (UnitMask & (1u << unit)));
+    }
+};
+
+
+//
+// The records of one read that match a coroutine's filter.  Iterating visits
+// the matching records in place in the client's shared buffer.  Converts to
+// false once the client has been stopped.
+//
+class PL_AsyncBatch
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(const PL_WaveLong* p, const PL_WaveLong* end, const PL_EventFilter* filter)
+            : m_p(p), m_end(end), m_filter(filter) { Skip(); }
+        const PL_WaveLong& operator*() const { return *m_p; }
+        const PL_WaveLong* operator->() const { return m_p; }
+        Iterator& operator++() { ++m_p; Skip(); return *this; }
+        bool operator!=(const Iterator& other) const { return m_p != other.m_p; }
+        bool operator==(const Iterator& other) const { return m_p == other.m_p; }
+
+    private:
+        void Skip() { while (m_p != m_end && !m_filter->Matches(*m_p)) ++m_p; }
+
+        const PL_WaveLong*      m_p;
+        const PL_WaveLong*      m_end;
+        const PL_EventFilter*   m_filter;
+    };
+
+    Iterator begin() const { return Iterator(m_records, m_records + m_count, &m_filter); }
+    Iterator end() const { return Iterator(m_records + m_count, m_records + m_count, &m_filter); }
+
+    int Size() const { return m_matches; }              // number of matching records
+    int ServerDropped() const { return m_serverDropped; }
+    int MMFDropped() const { return m_mmfDropped; }
+    explicit operator bool() const { return !m_closed; }
+
+private:
+    friend class PL_AsyncClient;
+
+    const PL_WaveLong*  m_records = nullptr;    // the whole read, matching or not
+    int                 m_count = 0;
+    int                 m_matches = 0;
+    int                 m_serverDropped = 0;
+    int                 m_mmfDropped = 0;
+    bool                m_closed = true;
+    PL_EventFilter      m_filter;
+};
+
+
+//
+// Coroutine return type for consumers: starts running immediately and is
+// destroyed when it finishes.  An exception escaping a task terminates the
+// program.
+//
+struct PL_AsyncTask
+{
+    struct promise_type
+    {
+        PL_AsyncTask get_return_object() { return PL_AsyncTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+
+//
+// Reads the server on the thread that calls Run() and resumes the coroutines
+// waiting in NextBatch.  The client must already be connected with
+// PL_InitClientEx3.
+//
+class PL_AsyncClient
+{
+public:
+    // maxPerRead - size of the shared read buffer, in records
+    explicit PL_AsyncClient(int maxPerRead = 65536)
+        : m_buffer(maxPerRead > 0 ? maxPerRead : 1) {}
+
+    PL_AsyncClient(const PL_AsyncClient&) = delete;
+    PL_AsyncClient& operator=(const PL_AsyncClient&) = delete;
+
+    // Awaitable returned by NextBatch
+    class Awaiter
+    {
+    public:
+        Awaiter(PL_AsyncClient* client, const PL_EventFilter& filter)
+            : m_client(client) { m_batch.m_filter = filter; }
+
+        bool await_ready() const { return m_client->m_stopped.load(); }
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            m_client->Enqueue(this);
+        }
+        PL_AsyncBatch await_resume() const { return m_batch; }
+
+    private:
+        friend class PL_AsyncClient;
+
+        PL_AsyncClient*         m_client;
+        PL_AsyncBatch           m_batch;
+        std::coroutine_handle<> m_handle;
+    };
+
+    // co_await NextBatch(filter) suspends the calling coroutine until a read
+    // contains at least one record matching filter
+    Awaiter NextBatch(const PL_EventFilter& filter = PL_EventFilter())
+    {
+        return Awaiter(this, filter);
+    }
+
+    // Reads and dispatches until Stop() is called or the server closes the
+    // ring, then resumes every waiting coroutine with a batch that converts to
+    // false
+    void Run()
+    {
+        while (!m_stopped.load())
+        {
+            if (Wait() < 0)
+            {
+                m_stopped.store(true);
+                break;
+            }
+            int n = (int)m_buffer.size();
+            int serverDropped, mmfDropped, pollHigh, pollLow;
+            PL_GetLongWaveFormStructuresEx2(&n, m_buffer.data(), &serverDropped, &mmfDropped,
+                                            &pollHigh, &pollLow);
+            if (n > 0 || serverDropped > 0 || mmfDropped > 0)
+                Dispatch(n, serverDropped, mmfDropped);
+        }
+        Dispatch(-1, 0, 0);
+    }
+
+    // May be called from any thread or from a coroutine
+    void Stop() { m_stopped.store(true); }
+
+private:
+    void Enqueue(Awaiter* awaiter)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_waiting.push_back(awaiter);
+    }
+
+    // hands the records just read (n < 0 when stopping) to every waiting
+    // coroutine whose filter matches at least one of them
+    void Dispatch(int n, int serverDropped, int mmfDropped)
+    {
+        std::vector<Awaiter*> waiting;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            waiting.swap(m_waiting);
+        }
+        for (Awaiter* awaiter : waiting)
+        {
+            PL_AsyncBatch& batch = awaiter->m_batch;
+            int matches = 0;
+            for (int i = 0; i < n; i++)
+                matches += batch.m_filter.Matches(m_buffer[i]);
+            if (n >= 0 && matches == 0 && serverDropped == 0 && mmfDropped == 0)
+            {
+                Enqueue(awaiter);
+                continue;
+            }
+            batch.m_records = m_buffer.data();
+            batch.m_count = n < 0 ? 0 : n;
+            batch.m_matches = matches;
+            batch.m_serverDropped = serverDropped;
+            batch.m_mmfDropped = mmfDropped;
+            batch.m_closed = n < 0;
+            awaiter->m_handle.resume();
+        }
+    }
+
+    // waits for the server to publish more data; returns -1 once the server
+    // has closed the ring
+    int Wait()
+    {
+        int interval = PL_GetPollingInterval();
+        if (interval <= 0)
+            interval = 10;
+#ifdef _WIN32
+        Sleep(interval);
+        return 0;
+#else
+        return PL_WaitForData(1, interval*1000);
+#endif
+    }
+
+    std::vector<PL_WaveLong>    m_buffer;
+    std::vector<Awaiter*>       m_waiting;
+    std::mutex                  m_mutex;
+    std::atomic<bool>           m_stopped{false};
+};
+
+
+#endif
@@ -0,0 +1,272 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PlexonClient.h - RAII C++ client object over the Plexon client API
+//
+// Header only.  PL_Client owns the server connection (PL_InitClientEx3 in
+// the constructor, PL_CloseClient in the destructor) and one reusable read
+// buffer, PL_ReadBuffer.  The buffer is allocated on huge pages where the
+// system allows it, touched page by page when it is allocated (pre-faulted)
+// and optionally locked in RAM, so the first large reads run as fast as
+// the later ones instead of taking page faults inside the read loop.
+//
+//      PL_Client client;
+//      if (!client.IsConnected())
+//          ...
+//      for (;;)
+//      {
+//          int n = client.Read();
+//          const PL_WaveLong* records = client.Records();
+//          ...
+//      }
+//
+// The buffer starts small and grows (by powers of two, up to maxRecords)
+// when the backlog is larger than it; it never shrinks, so steady-state reads
+// do not allocate.  The connection is process-wide, so only one PL_Client
+// should exist at a time.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef _PLEXONCLIENT_H_INCLUDED
+#define _PLEXONCLIENT_H_INCLUDED
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Plexon.h"
+#ifndef _WIN32
+#include "PlexonShm.h"
+#endif
+
+
+// PL_ReadBuffer flags
+#define PL_BUFFER_HUGEPAGES     (1)     // try to back the buffer with huge pages
+#define PL_BUFFER_LOCK          (2)     // lock the buffer in RAM (mlock / VirtualLock)
+
+// PL_Client defaults
+#define PL_CLIENT_INITIAL_RECORDS   (4096)
+#define PL_CLIENT_MAX_RECORDS       (500000)    // MAX_MAP_EVENTS_PER_READ of the samples
+
+
+//
+// Pre-faulted buffer of PL_WaveLong records
+//
+class PL_ReadBuffer
+{
+public:
+    explicit PL_ReadBuffer(unsigned flags = PL_BUFFER_HUGEPAGES)
+        : m_flags(flags) {}
+    ~PL_ReadBuffer() { Free(); }
+
+    PL_ReadBuffer(const PL_ReadBuffer&) = delete;
+    PL_ReadBuffer& operator=(const PL_ReadBuffer&) = delete;
+
+    // makes room for at least records records, discarding the contents if the
+    // buffer has to move; returns false if the memory could not be allocated
+    bool Reserve(size_t records)
+    {
+        if (records <= m_capacity)
+            return true;
+        size_t bytes = Round(records*sizeof(PL_WaveLong));
+        void* p = Allocate(bytes);
+        if (!p)
+            return false;
+        Free();
+        m_records = (PL_WaveLong*)p;
+        m_bytes = bytes;
+        m_capacity = bytes/sizeof(PL_WaveLong);
+        return true;
+    }
+
+    PL_WaveLong*    Data() const { return m_records; }
+    size_t          Capacity() const { return m_capacity; }     // in records
+    bool            IsHuge() const { return m_huge; }           // backed by huge pages
+    bool            IsLocked() const { return m_locked; }       // locked in RAM
+
+private:
+    static const size_t HugePageSize = 2*1024*1024;
+
+    // whole huge pages when huge pages are wanted, whole pages otherwise
+    size_t Round(size_t bytes) const
+    {
+        size_t unit = (m_flags & PL_BUFFER_HUGEPAGES) ? HugePageSize : 4096;
+        return (bytes + unit - 1)/unit*unit;
+    }
+
+    void* Allocate(size_t bytes)
+    {
+        void* p = NULL;
+        m_huge = false;
+        m_locked = false;
+#ifdef _WIN32
+        p = VirtualAlloc(NULL, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (!p)
+            return NULL;
+#else
+        //** explicit huge pages need pages reserved by the administrator
+        //** (vm.nr_hugepages); otherwise fall back to transparent huge pages
+        if (m_flags & PL_BUFFER_HUGEPAGES)
+        {
+            p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            m_huge = p != MAP_FAILED;
+        }
+        if (!m_huge)
+        {
+            p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return NULL;
+            if (m_flags & PL_BUFFER_HUGEPAGES)
+                m_huge = madvise(p, bytes, MADV_HUGEPAGE) == 0;
+        }
+#endif
+        //** fault every page in now rather than in the first reads
+        for (size_t offset = 0; offset < bytes; offset += 4096)
+            ((volatile char*)p)[offset] = 0;
+
+        if (m_flags & PL_BUFFER_LOCK)
+        {
+#ifdef _WIN32
+            m_locked = VirtualLock(p, bytes) != 0;
+#else
+            m_locked = mlock(p, bytes) == 0;
+#endif
+        }
+        return p;
+    }
+
+    void Free()
+    {
+        if (!m_records)
+            return;
+#ifdef _WIN32
+        VirtualFree(m_records, 0, MEM_RELEASE);
+#else
+        munmap(m_records, m_bytes);
+#endif
+        m_records = NULL;
+        m_bytes = 0;
+        m_capacity = 0;
+    }
+
+    unsigned        m_flags;
+    PL_WaveLong*    m_records = NULL;
+    size_t          m_bytes = 0;
+    size_t          m_capacity = 0;
+    bool            m_huge = false;
+    bool            m_locked = false;
+};
+
+
+//
+// Connection to the server plus the buffer it reads into
+//
+class PL_Client
+{
+public:
+    // type - client type passed to PL_InitClientEx3
+    // flags - PL_BUFFER_* flags for the read buffer
+    // initialRecords, maxRecords - initial and largest buffer size in records
+    explicit PL_Client(int type = 0, unsigned flags = PL_BUFFER_HUGEPAGES,
+                       int initialRecords = PL_CLIENT_INITIAL_RECORDS,
+                       int maxRecords = PL_CLIENT_MAX_RECORDS)
+        : m_buffer(flags), m_maxRecords(maxRecords > 0 ? maxRecords : 1)
+    {
+        m_connected = PL_InitClientEx3(type, NULL, NULL) != 0;
+        if (initialRecords > m_maxRecords)
+            initialRecords = m_maxRecords;
+        m_buffer.Reserve(initialRecords > 0 ? initialRecords : 1);
+    }
+
+    ~PL_Client()
+    {
+        if (m_connected)
+            PL_CloseClient();
+#ifndef _WIN32
+        delete m_config;
+#endif
+    }
+
+    PL_Client(const PL_Client&) = delete;
+    PL_Client& operator=(const PL_Client&) = delete;
+
+    bool IsConnected() const { return m_connected && m_buffer.Data() != NULL; }
+
+    // reads the records published since the last read into the buffer and
+    // returns their number
+    int Read()
+    {
+        if (!IsConnected())
+            return 0;
+        Grow();
+        int n = (int)m_buffer.Capacity();
+        if (n > m_maxRecords)
+            n = m_maxRecords;
+        PL_GetLongWaveFormStructuresEx2(&n, m_buffer.Data(), &m_serverDropped, &m_mmfDropped,
+                                        &m_pollHigh, &m_pollLow);
+        m_full = n == (int)m_buffer.Capacity();
+        return n;
+    }
+
+    // records of the last Read(); valid until the next Read()
+    const PL_WaveLong*      Records() const { return m_buffer.Data(); }
+    int                     ServerDropped() const { return m_serverDropped; }
+    int                     MMFDropped() const { return m_mmfDropped; }
+    int                     PollHigh() const { return m_pollHigh; }
+    int                     PollLow() const { return m_pollLow; }
+    const PL_ReadBuffer&    Buffer() const { return m_buffer; }
+
+#ifndef _WIN32
+    // server configuration; the cached snapshot is only taken again when its
+    // generation has changed, so this is cheap to call after every Read()
+    const PL_ConfigSnapshot& Config()
+    {
+        if (!m_config)
+            m_config = new PL_ConfigSnapshot();
+        if (m_config->Generation != PL_GetConfigGeneration())
+            PL_GetConfigSnapshot(m_config);
+        return *m_config;
+    }
+#endif
+
+private:
+    // grows the buffer ahead of a read that would not fit: to the pending
+    // backlog where the library can report it, otherwise after a read that
+    // filled the buffer
+    void Grow()
+    {
+        size_t want = m_buffer.Capacity();
+#ifndef _WIN32
+        size_t pending = (size_t)PL_GetPendingCount();
+        while (want < pending)
+            want *= 2;
+#endif
+        if (m_full)
+            want *= 2;
+        if (want > (size_t)m_maxRecords)
+            want = (size_t)m_maxRecords;
+        m_buffer.Reserve(want);
+        m_full = false;
+    }
+
+    PL_ReadBuffer   m_buffer;
+    int             m_maxRecords;
+    bool            m_connected = false;
+    bool            m_full = false;
+    int             m_serverDropped = 0;
+    int             m_mmfDropped = 0;
+    int             m_pollHigh = 0;
+    int             m_pollLow = 0;
+#ifndef _WIN32
+    PL_ConfigSnapshot* m_config = NULL;
+#endif
+};
+
+
+#endif
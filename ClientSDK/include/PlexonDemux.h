@@ -0,0 +1,288 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PlexonDemux.h - per-channel demultiplexer for the Plexon client API
+//
+// Header only; requires a C++20 compiler.  PL_Demux splits the interleaved
+// records of each read into per-channel queues, so that each electrode can
+// be processed by its own worker thread:
+//
+//      PL_Demux demux;
+//      for (int ch = 1; ch <= 16; ch++)
+//      {
+//          int q = demux.AddQueue();
+//          demux.Route(PL_SingleWFType, ch, q);    // spikes of DSP channel ch
+//          demux.Route(PL_ADDataType, ch - 1, q);  // and its continuous channel
+//      }
+//
+//      reader thread:                      worker thread for queue q:
+//          n = client.Read();                  PL_WaveLong rec[256];
+//          demux.Demux(client.Records(), n);   int k = demux.Queue(q).Pop(rec, 256);
+//
+// Demux routes a whole read in one counting-sort pass (look up the queue of
+// every record, count, place) and then appends each queue's records with a
+// single release store.  Every queue is a single-producer/single-consumer
+// ring: the thread calling Demux is the only producer and one worker is the
+// only consumer, and neither ever takes a lock.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef _PLEXONDEMUX_H_INCLUDED
+#define _PLEXONDEMUX_H_INCLUDED
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "Plexon.h"
+#ifndef _WIN32
+#include "PlexonShm.h"
+#endif
+
+
+#define PL_DEMUX_DEFAULT_CAPACITY   (8192)      // records per queue
+#define PL_DEMUX_MAX_CHANNEL        (512)       // channels at or above this number are not routed
+
+
+//
+// Bounded lock-free single-producer/single-consumer queue
+//
+template <class T>
+class PL_SpscQueue
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit PL_SpscQueue(size_t capacity = PL_DEMUX_DEFAULT_CAPACITY)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        m_items.reset(new T[size]);
+        m_mask = size - 1;
+    }
+
+    PL_SpscQueue(const PL_SpscQueue&) = delete;
+    PL_SpscQueue& operator=(const PL_SpscQueue&) = delete;
+
+    // producer: appends as many of the n items as fit, returns their number;
+    // the rest are counted as dropped
+    size_t Push(const T* items, size_t n)
+    {
+        return PushFrom(n, [items](size_t i) -> const T& { return items[i]; });
+    }
+
+    // producer: same as Push, from pointers to the items
+    size_t Push(const T* const* items, size_t n)
+    {
+        return PushFrom(n, [items](size_t i) -> const T& { return *items[i]; });
+    }
+
+    // consumer: removes up to nmax items into out, returns their number
+    size_t Pop(T* out, size_t nmax)
+    {
+        const T* items;
+        size_t n = Peek(&items);
+        if (n > nmax)
+            n = nmax;
+        memcpy((void*)out, items, n*sizeof(T));
+        size_t rest = nmax - n;
+        Consume(n);
+        //** the items may wrap around the end of the ring
+        if (rest > 0 && n > 0)
+        {
+            size_t more = Peek(&items);
+            if (more > rest)
+                more = rest;
+            memcpy((void*)(out + n), items, more*sizeof(T));
+            Consume(more);
+            n += more;
+        }
+        return n;
+    }
+
+    // consumer: the longest contiguous run of queued items, without removing
+    // them; returns its length
+    size_t Peek(const T** items)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (m_tailCache == head)
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+        size_t n = m_tailCache - head;
+        size_t slot = head & m_mask;
+        if (n > m_mask + 1 - slot)
+            n = m_mask + 1 - slot;
+        *items = &m_items[slot];
+        return n;
+    }
+
+    // consumer: removes the first n items seen with Peek
+    void Consume(size_t n)
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + n, std::memory_order_release);
+    }
+
+    size_t              Size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+    size_t              Capacity() const { return m_mask + 1; }
+    unsigned long long  Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    template <class Item>
+    size_t PushFrom(size_t n, Item item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t capacity = m_mask + 1;
+        if (tail - m_headCache + n > capacity)
+            m_headCache = m_head.load(std::memory_order_acquire);
+        size_t room = capacity - (tail - m_headCache);
+        size_t count = n < room ? n : room;
+        for (size_t i = 0; i < count; i++)
+            m_items[(tail + i) & m_mask] = item(i);
+        if (count < n)
+            m_dropped.fetch_add(n - count, std::memory_order_relaxed);
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    std::unique_ptr<T[]>        m_items;
+    size_t                      m_mask;
+
+    //** consumer side
+    alignas(64) std::atomic<size_t>     m_head{0};
+    size_t                              m_tailCache = 0;
+
+    //** producer side
+    alignas(64) std::atomic<size_t>     m_tail{0};
+    size_t                              m_headCache = 0;
+    std::atomic<unsigned long long>     m_dropped{0};
+};
+
+typedef PL_SpscQueue<PL_WaveLong> PL_RecordQueue;
+
+
+//
+// Routes records to PL_RecordQueues by type and channel
+//
+class PL_Demux
+{
+public:
+    PL_Demux()
+    {
+        memset(m_route, 0, sizeof(m_route));
+    }
+
+    PL_Demux(const PL_Demux&) = delete;
+    PL_Demux& operator=(const PL_Demux&) = delete;
+
+    // adds a queue and returns its id; routes are set up with Route
+    int AddQueue(size_t capacity = PL_DEMUX_DEFAULT_CAPACITY)
+    {
+        m_queues.emplace_back(new PL_RecordQueue(capacity));
+        return (int)m_queues.size() - 1;
+    }
+
+    // sends the records of one type and channel to a queue (-1 to none); set
+    // up routes before the first Demux
+    void Route(int type, int channel, int queue)
+    {
+        if (type < 0 || type >= Types || channel < 0 || channel >= PL_DEMUX_MAX_CHANNEL ||
+            queue < -1 || queue >= (int)m_queues.size())
+            return;
+        m_route[type][channel] = (uint16_t)(queue + 1);
+    }
+
+    PL_RecordQueue& Queue(int id) { return *m_queues[id]; }
+    int             NumQueues() const { return (int)m_queues.size(); }
+
+    // producer: routes n records, returns the number appended to queues
+    int Demux(const PL_WaveLong* records, int n)
+    {
+        Partition(records, n);
+        return Push();
+    }
+
+#ifndef _WIN32
+    // producer: routes the records of a PL_AcquireBatch batch in place, so
+    // they are copied only once, into the queues; release the batch afterwards
+    // (if PL_ReleaseBatch returns 0, some of the queued records may be torn)
+    int Demux(const PL_Batch& batch)
+    {
+        m_slots.clear();
+        m_start.assign(m_queues.size() + 2, 0);
+        for (int span = 0; span < 2; span++)
+            Count(batch.Spans[span].Records, batch.Spans[span].Count);
+        Place();
+        for (int span = 0; span < 2; span++)
+            Scatter(batch.Spans[span].Records, batch.Spans[span].Count);
+        return Push();
+    }
+#endif
+
+private:
+    static const int Types = 8;
+
+    void Partition(const PL_WaveLong* records, int n)
+    {
+        m_slots.clear();
+        m_start.assign(m_queues.size() + 2, 0);
+        Count(records, n);
+        Place();
+        Scatter(records, n);
+    }
+
+    // looks up the queue of every record (0 = none, queue id + 1 otherwise)
+    // and counts the records per queue
+    void Count(const PL_WaveLong* records, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t type = (uint32_t)(unsigned char)records[i].Type & (Types - 1);
+            uint32_t ch = (uint32_t)(unsigned short)records[i].Channel;
+            uint16_t slot = ch < PL_DEMUX_MAX_CHANNEL ? m_route[type][ch] : 0;
+            m_slots.push_back(slot);
+            m_start[slot + 1]++;
+        }
+    }
+
+    // turns the counts into the first position of each queue's run
+    void Place()
+    {
+        for (size_t slot = 1; slot < m_start.size(); slot++)
+            m_start[slot] += m_start[slot - 1];
+        m_next = m_start;
+        m_sorted.resize(m_slots.size());
+        m_scattered = 0;
+    }
+
+    void Scatter(const PL_WaveLong* records, int n)
+    {
+        for (int i = 0; i < n; i++)
+            m_sorted[m_next[m_slots[m_scattered++]]++] = records + i;
+    }
+
+    // appends each queue's run with one release store
+    int Push()
+    {
+        int pushed = 0;
+        for (size_t q = 0; q < m_queues.size(); q++)
+        {
+            size_t first = m_start[q + 1];
+            size_t count = m_start[q + 2] - first;
+            if (count)
+                pushed += (int)m_queues[q]->Push(m_sorted.data() + first, count);
+        }
+        return pushed;
+    }
+
+    uint16_t                                        m_route[Types][PL_DEMUX_MAX_CHANNEL];
+    std::vector<std::unique_ptr<PL_RecordQueue>>    m_queues;
+    std::vector<uint16_t>                           m_slots;        // queue slot of each record of the read
+    std::vector<size_t>                             m_start;        // first position of each slot's run
+    std::vector<size_t>                             m_next;
+    std::vector<const PL_WaveLong*>                 m_sorted;       // the read, grouped by slot
+    size_t                                          m_scattered = 0;
+};
+
+
+#endif
@@ -0,0 +1,960 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// PlexonShm.h - client API extensions of the Linux shared-memory
+//               PlexClient library
+//
+// These calls are only available in the Linux libPlexClient.so (see
+// ClientSDK/Linux), which implements the Plexon.h client API on top of a
+// POSIX shared-memory ring.  They are used together with the Plexon.h calls,
+// after PL_InitClientEx3 has connected to the server.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef _PLEXONSHM_H_INCLUDED
+#define _PLEXONSHM_H_INCLUDED
+
+#include "Plexon.h"
+#include "PlexServer.h"
+
+
+//
+// A run of consecutive records inside the shared ring
+//
+struct PL_RecordSpan
+{
+    const PL_WaveLong*  Records;        // first record, points into shared memory
+    int                 Count;          // number of records
+};
+
+//
+// Records borrowed from the shared ring by PL_AcquireBatch.  The records are
+// Spans[0] followed by Spans[1]; Spans[1] is only non-empty when the batch
+// wraps around the end of the ring.
+//
+struct PL_Batch
+{
+    PL_RecordSpan   Spans[2];
+    int             NumRecords;         // Spans[0].Count + Spans[1].Count
+    int             ServerDropped;      // number of records dropped by the server
+    int             MMFDropped;         // number of records overwritten before they could be read
+    int             PollHigh;           // high DWORD of the poll time of the last publish
+    int             PollLow;            // low DWORD of the poll time of the last publish
+    unsigned long long FirstSequence;   // sequence number of the first record (see PL_GetStreamPosition)
+    int             Replayed;           // 1 if the records were replayed (see PL_CLIENT_REPLAY)
+};
+
+
+// PL_AcquireBatch - borrow recent records without copying them
+// In:
+//      nmax - maximum number of records to borrow
+// Out:
+//      batch - spans of PL_WaveLong records inside the shared ring
+// Returns:
+//      number of records borrowed
+// Effect:
+//      Returns the records that the server published since the last
+//          PL_Get* or PL_ReleaseBatch call, in place.  The client's read
+//          position does not move until PL_ReleaseBatch is called; acquiring
+//          again without releasing gives the same records back.
+//      The records must be treated as read-only and may be overwritten by the
+//          server if the client holds them for longer than the ring takes to
+//          wrap; PL_ReleaseBatch reports whether that happened.
+extern "C" int      WINAPI PL_AcquireBatch(int nmax, PL_Batch* batch);
+
+
+// PL_ReleaseBatch - give back a batch borrowed with PL_AcquireBatch
+// In:
+//      count - number of records consumed from the start of the batch;
+//              the next PL_AcquireBatch or PL_Get* call starts after them
+// Returns:
+//      1 if the consumed records were intact for the whole time they were
+//          borrowed, 0 if the server may have overwritten some of them (the
+//          results computed from the batch should then be discarded)
+extern "C" int      WINAPI PL_ReleaseBatch(int count);
+
+
+// PL_WaitForData - wait until enough new data is available
+// In:
+//      minEvents - number of unread records to wait for
+//      maxWaitMicros - maximum time to wait in microseconds; 0 only checks,
+//                      a negative value waits without a time limit
+// Returns:
+//      number of unread records (less than minEvents if the wait timed out),
+//          or -1 if the client is not connected or the server has closed the
+//          ring and no unread records are left
+// Effect:
+//      Sleeps on a futex in the shared segment that the server signals as
+//          soon as the client's minEvents-th unread record is published, so
+//          the client wakes on data rather than on the server's polling
+//          interval.  Replaces waiting on the Windows "PlexonServerEvent".
+extern "C" int      WINAPI PL_WaitForData(int minEvents, int maxWaitMicros);
+
+
+//
+// Subscription filter applied by PL_SetSubscription.  A record is delivered if
+// its Type bit is set in TypeMask, its Channel bit is set in the channel mask
+// of its type and, for spikes only, its Unit bit is set in UnitMask.
+//
+#define PL_SUB_MAX_TYPE         (5)     // highest record type that can be selected (PL_ADDataType)
+#define PL_SUB_MAX_CHANNEL      (512)   // channels at or above this number are never delivered
+
+struct PL_Subscription
+{
+    unsigned int    TypeMask;           // bit (1 << Type) for each record type wanted
+    unsigned int    UnitMask;           // bit (1 << Unit) for each spike unit wanted, bit 0 = unsorted
+    unsigned int    ChannelMask[PL_SUB_MAX_TYPE + 1][PL_SUB_MAX_CHANNEL / 32];  // [Type][Channel / 32]
+};
+
+
+// PL_SubscriptionInit - initialize a subscription filter
+// In:
+//      all - if nonzero, the filter selects every record; otherwise it
+//            selects nothing and channels are added with
+//            PL_SubscriptionAddChannels
+// Out:
+//      sub - the initialized filter; UnitMask selects all units either way
+extern "C" void     WINAPI PL_SubscriptionInit(PL_Subscription* sub, int all);
+
+
+// PL_SubscriptionAddChannels - select a range of channels of one record type
+// In:
+//      type - PL_SingleWFType, PL_ExtEventType or PL_ADDataType
+//      first, last - inclusive channel range, e.g. 1..16 for the first 16 DSP
+//                    channels or PL_StrobedExtChannel..PL_StrobedExtChannel
+// Out:
+//      sub - filter with the type and the channels added
+extern "C" void     WINAPI PL_SubscriptionAddChannels(PL_Subscription* sub, int type,
+                                                      int first, int last);
+
+
+// PL_SetSubscription - restrict the records delivered to this client
+// In:
+//      sub - the filter, or NULL to receive every record again
+// Effect:
+//      All PL_GetTimeStamp* and PL_GetWave* calls skip records that do not
+//          match the filter.  Only the 16-byte header of a skipped record is
+//          examined; its waveform is never copied.  Skipped records still
+//          advance the client's read position and are counted by
+//          PL_WaitForData.  PL_AcquireBatch returns records unfiltered.
+extern "C" void     WINAPI PL_SetSubscription(const PL_Subscription* sub);
+
+
+//
+// Decimation applied by PL_SetDecimation, for clients such as displays that
+// need every timestamp but not every waveform or sample
+//
+#define PL_DECIMATE_PICK        (0)     // keep every ContinuousFactor-th sample
+#define PL_DECIMATE_ENVELOPE    (1)     // keep the min and max of every ContinuousFactor samples
+
+struct PL_Decimation
+{
+    int     WaveformRate;       // waveforms per second kept per channel and unit, 0 for all
+    int     ContinuousFactor;   // continuous samples per sample (or min/max pair) kept, 0 or 1 for all
+    int     ContinuousMode;     // PL_DECIMATE_*
+};
+
+
+// PL_SetDecimation - thin the waveforms and samples delivered to this client
+// In:
+//      decimation - the settings, or NULL to receive every record in full again
+// Returns:
+//      1 if successful, 0 if not connected or the settings are invalid
+// Effect:
+//      Applies to the records that pass the subscription filter, in all
+//          PL_GetTimeStamp* and PL_GetWave* calls; PL_AcquireBatch returns
+//          records unchanged.  Spikes over WaveformRate are still delivered,
+//          with NumberOfDataWords 0 and their waveform never copied, so
+//          timestamps and unit counts stay complete.  Continuous records carry
+//          ContinuousFactor times fewer samples, taken on a grid of sample
+//          times common to all channels of a rate (sample i at
+//          round(i*ticks per second/rate), so rates need not divide the tick
+//          rate).  With PL_DECIMATE_ENVELOPE they carry min, max pairs
+//          instead, each covering the next ContinuousFactor sample times of
+//          the grid from the record's timestamp on; a pair is delivered once
+//          its last sample has been read, and only if none of its samples is
+//          missing.  Continuous records left without samples are not
+//          delivered.  The sample rate of the delivered data is each
+//          channel's PL_GetSlowInfo256 rate divided by ContinuousFactor.
+extern "C" int      WINAPI PL_SetDecimation(const PL_Decimation* decimation);
+
+
+// PL_GetTimeStampArraysEx - get recent records as separate arrays
+// In:
+//      *pnmax - maximum number of records to transfer
+//      wflength - number of points in each row of waves (ignored if waves is NULL)
+// Out:
+//      *pnmax - actual number of records transferred
+//      type - array of types (PL_SingleWFType, PL_ExtEventType or PL_ADDataType)
+//      ch - array of channel numbers
+//      unit - array of unit numbers (strobe values for events)
+//      ts - array of full 40-bit timestamps
+//      nwords - array of waveform lengths (NumberOfDataWords)
+//      waves - *pnmax by wflength row-major matrix of waveforms; row k holds
+//              the waveform of record k, truncated or zero-padded to wflength
+// Effect:
+//      Same as PL_GetTimeStampArrays, but timestamps keep their upper 8 bits
+//          and the waveforms are returned as one contiguous matrix.  Any of
+//          the output arrays may be NULL if the caller does not need it.
+//          The client's subscription filter applies.
+extern "C" void     WINAPI PL_GetTimeStampArraysEx(int* pnmax, short* type, short* ch,
+                                                   short* unit, unsigned long long* ts,
+                                                   short* nwords, short* waves, int wflength);
+
+
+// size in bytes of a record packed by PL_GetPackedWaveForms: the 16-byte
+// PL_Event header, nwords waveform points, padded to a multiple of 4 bytes
+#define PL_PACKED_RECORD_SIZE(nwords)   ((sizeof(PL_Event) + 2*(nwords) + 3) & ~(size_t)3)
+
+
+// PL_GetPackedWaveForms - get recent waveform records packed back to back
+// In:
+//      *pnmax - maximum number of records to transfer
+//      *bufsize - size of buffer in bytes; at least sizeof(PL_WaveLong) so that
+//                 any record fits
+// Out:
+//      *pnmax - actual number of records transferred
+//      *bufsize - number of bytes of buffer used
+//      buffer - records, each a PL_Event header followed by NumberOfDataWords
+//               waveform points, PL_PACKED_RECORD_SIZE(NumberOfDataWords) bytes
+//               long and 4-byte aligned
+//      offsets - byte offset of each record in buffer, may be NULL
+//      *serverdropped - number of waveforms that were dropped in MXI transfer
+//      *mmfdropped - number of waveforms that were dropped in MMF->client transfer
+// Effect:
+//      Same as PL_GetLongWaveFormStructures, but only the waveform points
+//          that a record actually carries are copied, so events take 16 bytes
+//          instead of 256.  Stops early when buffer is full; the remaining
+//          records are returned by the next call.  The client's subscription
+//          filter applies.
+extern "C" void     WINAPI PL_GetPackedWaveForms(int* pnmax, void* buffer, int* bufsize,
+                                                 int* offsets, int* serverdropped,
+                                                 int* mmfdropped);
+
+
+// PL_GetPendingCount - number of records waiting to be read
+// Returns:
+//      number of records published since the last read that are still in
+//          the ring, i.e. what the next PL_Get* call would return without a
+//          size limit or subscription filter
+extern "C" int      WINAPI PL_GetPendingCount();
+
+
+// PL_SkipToTimeStamp - discard unread records older than a given time
+// In:
+//      ts - full 40-bit timestamp; records with an earlier timestamp are skipped
+// Returns:
+//      number of records discarded
+// Effect:
+//      Moves the client's read position by binary search, without copying
+//          anything.  Skipped records are not counted as dropped.
+extern "C" int      WINAPI PL_SkipToTimeStamp(unsigned long long ts);
+
+
+// PL_SkipToLatest - discard all unread records
+// Returns:
+//      number of records discarded
+// Effect:
+//      The next PL_Get* call returns only records published after this call.
+//          Use this instead of draining the backlog when a client (re)starts.
+extern "C" int      WINAPI PL_SkipToLatest();
+
+
+//
+// Configuration of the server and of every channel, returned as one
+// consistent snapshot by PL_GetConfigSnapshot.  The server bumps Generation
+// whenever any part of it changes.
+//
+#define PL_CONFIG_MAX_CHANNELS          (256)   // DSP (spike) channels
+#define PL_CONFIG_MAX_EVENT_CHANNELS    (512)   // external event channels
+#define PL_CONFIG_MAX_SLOW_CHANNELS     (256)   // continuous (NIDAQ) channels
+#define PL_CONFIG_MAX_UNITS             (4)     // sorted units per channel (units 1 to 4)
+#define PL_CONFIG_TEMPLATE_POINTS       (64)    // points per template
+#define PL_CONFIG_NAME_LENGTH           (32)    // bytes per name, including the terminating 0
+
+struct PL_ConfigSnapshot
+{
+    unsigned long long  Generation;     // changes whenever the configuration changes
+    PL_ServerInfo       Info;           // global parameters
+    int                 NumSignals;     // PL_GetChannelInfo nsig
+    int                 NumOutputs;     // PL_GetChannelInfo nout
+    int                 NPointsSort;    // points used for sorting
+
+    // per DSP channel, index 0 = channel 1
+    int     SIG[PL_CONFIG_MAX_CHANNELS];
+    int     Filter[PL_CONFIG_MAX_CHANNELS];
+    int     Gain[PL_CONFIG_MAX_CHANNELS];
+    int     Method[PL_CONFIG_MAX_CHANNELS];
+    int     Threshold[PL_CONFIG_MAX_CHANNELS];
+    int     NumUnits[PL_CONFIG_MAX_CHANNELS];
+    int     Templates[PL_CONFIG_MAX_CHANNELS][PL_CONFIG_MAX_UNITS][PL_CONFIG_TEMPLATE_POINTS];
+    char    Names[PL_CONFIG_MAX_CHANNELS][PL_CONFIG_NAME_LENGTH];
+
+    // per event channel, index 0 = channel 1
+    char    EventNames[PL_CONFIG_MAX_EVENT_CHANNELS][PL_CONFIG_NAME_LENGTH];
+
+    // per continuous channel, index 0 = channel 0
+    int     SlowGains[PL_CONFIG_MAX_SLOW_CHANNELS];
+    int     SlowFrequencies[PL_CONFIG_MAX_SLOW_CHANNELS];   // sampling rate in Hz
+    char    SlowChanNames[PL_CONFIG_MAX_SLOW_CHANNELS][PL_CONFIG_NAME_LENGTH];
+};
+
+
+// PL_GetConfigSnapshot - get the whole server configuration in one call
+// Out:
+//      config - consistent copy of the configuration and its generation
+// Returns:
+//      1 if successful, 0 if the client is not connected
+// Effect:
+//      Replaces the separate PL_GetGlobalParsEx, PL_GetChannelInfo,
+//          PL_GetGain, PL_GetThreshold, PL_GetTemplate, PL_GetName... calls,
+//          which each read only one part of the configuration and may see
+//          different versions of it.  Clients can cache the snapshot and
+//          compare PL_GetConfigGeneration with its Generation to find out
+//          when to take a new one.
+extern "C" int      WINAPI PL_GetConfigSnapshot(PL_ConfigSnapshot* config);
+
+
+// PL_GetConfigGeneration - current configuration generation
+// Returns:
+//      the Generation a snapshot taken now would have, 0 if not connected.
+//      A single read of shared memory, cheap enough to call on every read.
+extern "C" unsigned long long WINAPI PL_GetConfigGeneration();
+
+
+//
+// Clock model fitted by the library to the clock samples published by the
+// server: host time = RefHostNanos + (timestamp - RefTimeStamp) * NanosPerTick.
+// Host times are CLOCK_MONOTONIC nanoseconds, the clock that the pollhigh /
+// polllow values of the PL_Get*Ex calls are read from.
+//
+struct PL_ClockModel
+{
+    unsigned long long  RefTimeStamp;   // MAP timestamp of the reference point
+    unsigned long long  RefHostNanos;   // fitted host time at RefTimeStamp
+    double              NanosPerTick;   // fitted; TimeStampTick * 1000 for a MAP clock without drift
+    double              DriftPPM;       // NanosPerTick relative to the nominal tick, in parts per million
+    double              ResidualNanos;  // rms distance of the samples from the fit
+    int                 NumSamples;     // clock samples used
+};
+
+// host time of a pollhigh / polllow pair
+#define PL_POLL_TIME(pollhigh, polllow) \
+    (((unsigned long long)(unsigned)(pollhigh) << 32) | (unsigned)(polllow))
+
+
+// PL_GetClockModel - current fit of the MAP clock against the host clock
+// Out:
+//      model - the fitted model
+// Returns:
+//      1 if successful, 0 if not connected or the server has not published
+//          any clock samples yet
+// Effect:
+//      The library fits offset and drift by least squares to the most recent
+//          clock samples (a few seconds' worth) and refits whenever the server
+//          publishes a new one, so the model follows slow drift of either clock.
+extern "C" int      WINAPI PL_GetClockModel(PL_ClockModel* model);
+
+
+// PL_MapTimeToHost - host time at which a MAP timestamp was acquired
+// In:
+//      ts - full 40-bit MAP timestamp
+// Returns:
+//      CLOCK_MONOTONIC time in ns, or 0 if there is no clock model yet.
+//      PL_GetHostTime() - PL_MapTimeToHost(ts) is the acquisition-to-client
+//      latency of a record.
+extern "C" unsigned long long WINAPI PL_MapTimeToHost(unsigned long long ts);
+
+
+// PL_HostTimeToMap - MAP timestamp of a host time
+// In:
+//      hostNanos - CLOCK_MONOTONIC time in ns, e.g. PL_GetHostTime() or
+//                  PL_POLL_TIME(pollhigh, polllow)
+// Returns:
+//      the MAP timestamp the acquisition clock had at that time, or 0 if there
+//      is no clock model yet
+extern "C" unsigned long long WINAPI PL_HostTimeToMap(unsigned long long hostNanos);
+
+
+// PL_GetHostTime - current host time
+// Returns:
+//      CLOCK_MONOTONIC time in ns
+extern "C" unsigned long long WINAPI PL_GetHostTime();
+
+
+//
+// Latency statistics kept by the library for every read (PL_Get* call that
+// returns records, or PL_AcquireBatch).  Record ages use the clock model of
+// PL_MapTimeToHost and are only recorded once the server has published
+// clock samples.
+//
+#define PL_LATENCY_OLDEST       (0)     // age of the oldest record of a read, from acquisition to the end of the read
+#define PL_LATENCY_NEWEST       (1)     // age of the newest record of a read
+#define PL_LATENCY_PUBLISH      (2)     // time from the server's last publish to the end of the read
+#define PL_LATENCY_COPY         (3)     // time spent inside the read call
+#define PL_LATENCY_WAKEUP       (4)     // time between the starts of successive reads
+#define PL_LATENCY_COUNT        (5)
+
+struct PL_LatencyStats
+{
+    unsigned long long  Count;          // number of values recorded
+    unsigned long long  MinNanos;
+    unsigned long long  MaxNanos;
+    double              MeanNanos;
+    unsigned long long  P50Nanos;       // percentiles, within about 3%
+    unsigned long long  P90Nanos;
+    unsigned long long  P99Nanos;
+    unsigned long long  P999Nanos;
+};
+
+
+// PL_GetLatencyStats - summary of one latency histogram
+// In:
+//      which - PL_LATENCY_*
+// Out:
+//      stats - count, range, mean and percentiles, all in nanoseconds
+// Returns:
+//      1 if successful, 0 if not connected or which is out of range
+extern "C" int      WINAPI PL_GetLatencyStats(int which, PL_LatencyStats* stats);
+
+
+// PL_GetLatencyPercentile - any percentile of one latency histogram
+// In:
+//      which - PL_LATENCY_*
+//      percent - 0 to 100, e.g. 99.99
+// Returns:
+//      the percentile in nanoseconds, 0 if nothing has been recorded
+extern "C" unsigned long long WINAPI PL_GetLatencyPercentile(int which, double percent);
+
+
+// PL_GetLatencyHistogram - the buckets of one latency histogram
+// In:
+//      which - PL_LATENCY_*
+//      nmax - number of entries in lower and counts
+// Out:
+//      lower - smallest value of each non-empty bucket, in nanoseconds
+//      counts - number of values in each non-empty bucket
+// Returns:
+//      number of non-empty buckets (may exceed nmax)
+// Effect:
+//      Buckets are log-linear: exact below 64 ns, then 32 buckets per power
+//          of two.
+extern "C" int      WINAPI PL_GetLatencyHistogram(int which, unsigned long long* lower,
+                                                  unsigned long long* counts, int nmax);
+
+
+// PL_ResetLatencyStats - clear all latency histograms
+extern "C" void     WINAPI PL_ResetLatencyStats();
+
+
+//
+// Drops of one record type and channel (or a sum of them), counted since the
+// client connected or last called PL_ResetDropStats
+//
+#define PL_DROP_ALL             (-1)    // type or channel wildcard of PL_GetDropStats
+#define PL_DROP_UNATTRIBUTED    (-2)    // type of the drops that could not be attributed
+
+struct PL_DropStats
+{
+    unsigned long long  MMFDropped;                 // overwritten before this client read them
+    unsigned long long  ServerDropped;              // dropped by the server
+    unsigned long long  LastMMFDropTimeStamp;       // MAP timestamp of the newest record lost, 0 if none
+    unsigned long long  LastServerDropTimeStamp;    // as reported by the server, 0 if none or unknown
+};
+
+
+// PL_GetDropStats - drops of one channel, one record type or in total
+// In:
+//      type - PL_SingleWFType, PL_ExtEventType, PL_ADDataType..., PL_DROP_ALL
+//             for all types including unattributed drops, or
+//             PL_DROP_UNATTRIBUTED
+//      channel - channel number, or PL_DROP_ALL for all channels of type
+// Out:
+//      stats - cumulative counts and the timestamps of the last drops
+// Returns:
+//      1 if successful, 0 if not connected or type or channel is out of range
+// Effect:
+//      mmfdropped records are attributed from a shadow ring that keeps the
+//          type, channel and timestamp of the last 8 ring capacities of
+//          records; records lost by a client even further behind, or of
+//          channels at or above PL_SUB_MAX_CHANNEL, count as unattributed.
+//          serverdropped records are attributed when the server reports them
+//          with PL_ServerAddDroppedEx.
+extern "C" int      WINAPI PL_GetDropStats(int type, int channel, PL_DropStats* stats);
+
+
+// PL_GetDroppedChannels - channels of one record type that have lost records
+// In:
+//      type - record type
+//      nmax - number of entries in channels
+// Out:
+//      channels - channel numbers in increasing order
+// Returns:
+//      number of channels with drops (may exceed nmax)
+extern "C" int      WINAPI PL_GetDroppedChannels(int type, int* channels, int nmax);
+
+
+// PL_ResetDropStats - restart all drop counters of this client from zero
+extern "C" void     WINAPI PL_ResetDropStats();
+
+
+//
+// One user event sent with PL_SendUserEvents
+//
+#define PL_USER_EVENT_MAX_BATCH     (256)   // events per PL_SendUserEvents call
+
+struct PL_UserEvent
+{
+    int                 Channel;        // event channel, or PL_StrobedExtChannel for a strobed word
+    unsigned short      Word;           // strobed word value (PL_StrobedExtChannel only)
+    unsigned long long  TimeStamp;      // requested 40-bit MAP timestamp, 0 for as soon as possible
+};
+
+
+// PL_SendUserEvents - send a burst of user events to the server in one transaction
+// In:
+//      events - the events, in the order they must appear in the data stream
+//      n - number of events, at most PL_USER_EVENT_MAX_BATCH
+// Returns:
+//      1 if the events were queued, 0 if not connected, n is out of range
+//          or the server's queue is full (try again after a poll interval)
+// Effect:
+//      The server inserts all n events into the same publish, consecutively
+//          and in the given order; timestamps earlier than their predecessor's
+//          are raised to it, and timestamps the server has already published
+//          past are raised to its current time.  A batch with requested
+//          timestamps in the future is held until the server reaches the last
+//          of them.  One call costs a few hundred nanoseconds whatever n is.
+//          PL_SendUserEvent and PL_SendUserEventWord send one-event batches.
+extern "C" int      WINAPI PL_SendUserEvents(const PL_UserEvent* events, int n);
+
+
+//
+// Dispatch engine: the library reads the server on its own thread and hands
+// the records of each read to the handlers registered for their type,
+// channel and unit.  A handler is called at most once per read, with all of
+// its records of that read, in stream order.
+//
+#define PL_DISPATCH_ANY             (-1)    // wildcard for type, channel or unit
+#define PL_DISPATCH_MAX_HANDLERS    (255)
+
+typedef void (*PL_RecordHandler)(const PL_WaveLong* const* records, int count, void* context);
+
+
+// PL_AddHandler - register a handler for a type, channel and unit
+// In:
+//      type - record type, or PL_DISPATCH_ANY
+//      channel - channel number (0 to PL_SUB_MAX_CHANNEL - 1), or PL_DISPATCH_ANY
+//      unit - spike unit (0 to 31), or PL_DISPATCH_ANY; ignored for other types
+//      handler - called on the dispatch thread with pointers to the records
+//                of one read that map to it; valid until the handler returns
+//      context - passed to handler
+// Returns:
+//      handler id (1 to PL_DISPATCH_MAX_HANDLERS), 0 if no more can be added
+// Effect:
+//      Each record goes to exactly one handler: the one registered last among
+//          those that match it.  Records that match no handler are skipped, as
+//          are records of types above 7.  PL_DISPATCH_ANY channel handlers
+//          also get records of channels PL_SUB_MAX_CHANNEL and above.
+//          Handlers can be added or removed at any time, including from a
+//          handler; changes apply from the next read.
+extern "C" int      WINAPI PL_AddHandler(int type, int channel, int unit,
+                                         PL_RecordHandler handler, void* context);
+
+
+// PL_RemoveHandler - unregister a handler added with PL_AddHandler
+// Returns:
+//      1 if the handler was registered, 0 otherwise
+extern "C" int      WINAPI PL_RemoveHandler(int id);
+
+
+// PL_StartDispatch - start the dispatch thread
+// In:
+//      maxPerRead - maximum number of records read at a time, 0 for 65536
+// Returns:
+//      1 if the thread is running, 0 if not connected
+// Effect:
+//      The thread waits with PL_WaitForData, reads with
+//          PL_GetLongWaveFormStructuresEx2 and dispatches through a table
+//          indexed by type, channel and unit, built when handlers change.
+//          The client's subscription filter applies.  While the thread runs,
+//          no other thread may call the PL_Get* read functions.
+extern "C" int      WINAPI PL_StartDispatch(int maxPerRead);
+
+
+// PL_StopDispatch - stop the dispatch thread and wait for it to finish
+// Effect:
+//      Handlers stay registered for the next PL_StartDispatch.  Must not be
+//          called from a handler.  PL_CloseClient stops the thread as well.
+extern "C" void     WINAPI PL_StopDispatch();
+
+
+//
+// Snippet store: the latest spike waveforms of every unit, in a shared-memory
+// object of its own.  One process (usually the one reading the server) fills
+// it; any number of threads and processes, such as displays, read it without
+// connecting to the server and without ever blocking the filler.
+//
+#define PL_SNIPPET_DEFAULT_NAME     "/PlexonSnippets"
+#define PL_SNIPPET_DEFAULT_DEPTH    (256)   // waveforms kept per unit
+#define PL_SNIPPET_UNITS            (5)     // unsorted (0) and units a to d (1 to 4)
+
+
+// PL_CreateSnippetStore - create the snippet store and become its filler
+// In:
+//      name - shared-memory object name, or NULL for PL_SNIPPET_DEFAULT_NAME
+//      channels - number of DSP channels kept (1 to channels)
+//      depth - waveforms kept per channel and unit (rounded up to a power of
+//              two), or 0 for PL_SNIPPET_DEFAULT_DEPTH
+// Returns:
+//      1 if successful, 0 otherwise
+// Effect:
+//      Replaces any store of the same name.  A process has at most one store
+//          open, created or opened.
+extern "C" int      WINAPI PL_CreateSnippetStore(const char* name, int channels, int depth);
+
+
+// PL_PutSnippets - add spike waveforms to the snippet store
+// In:
+//      records - records as read with PL_GetLongWaveFormStructures* or
+//                PL_AcquireBatch; only PL_SingleWFType records are stored
+//      n - number of records
+// Returns:
+//      number of waveforms stored
+// Effect:
+//      Only the process that created the store may call it, from one thread
+//          at a time.  Costs one 256-byte copy per spike.
+extern "C" int      WINAPI PL_PutSnippets(const PL_WaveLong* records, int n);
+
+
+// PL_OpenSnippetStore - open a snippet store created by another process
+// In:
+//      name - shared-memory object name, or NULL for PL_SNIPPET_DEFAULT_NAME
+// Returns:
+//      1 if successful, 0 if there is no store
+extern "C" int      WINAPI PL_OpenSnippetStore(const char* name);
+
+
+// PL_GetLatestSnippets - take the newest waveforms of one unit
+// In:
+//      channel - DSP channel (1 to the store's channels)
+//      unit - 0 for unsorted, 1 to 4 for units a to d
+//      nmax - number of entries in snippets
+// Out:
+//      snippets - up to nmax waveforms, oldest first
+//      *total - waveforms stored for this unit since the store was created,
+//               may be NULL; a display can skip redrawing while it is unchanged
+// Returns:
+//      number of waveforms copied
+// Effect:
+//      Never waits for the filler: every snippet returned is intact, and if
+//          the filler overwrote some of them while they were copied the copy is
+//          retried, and after a few tries the newest intact ones are returned.
+//          Safe to call from any number of threads, in the filler's process too.
+extern "C" int      WINAPI PL_GetLatestSnippets(int channel, int unit, int nmax,
+                                                PL_WaveLong* snippets, unsigned long long* total);
+
+
+// PL_CloseSnippetStore - close the snippet store
+// Effect:
+//      The filler's store is removed; readers that have it open keep their
+//          view of it until they close it.  No PL_GetLatestSnippets call may
+//          be running.
+extern "C" void     WINAPI PL_CloseSnippetStore();
+
+
+//
+// History store: the last seconds of every continuous channel, in a
+// shared-memory object of its own.  One process (the server or a client
+// reading it) fills it; any number of others read any time window of any
+// channel from it without connecting to the server or keeping their own copy.
+//
+#define PL_HISTORY_DEFAULT_NAME     "/PlexonHistory"
+#define PL_HISTORY_DEFAULT_SECONDS  (10)    // seconds kept per channel
+
+
+// PL_CreateHistoryStore - create the history store and become its filler
+// In:
+//      name - shared-memory object name, or NULL for PL_HISTORY_DEFAULT_NAME
+//      channels - number of continuous channels kept (0 to channels - 1)
+//      seconds - seconds kept per channel (rounded up so that each channel
+//                keeps a power of two of samples), or 0 for
+//                PL_HISTORY_DEFAULT_SECONDS
+//      freqs - sampling rate of each channel in Hz, or NULL for the rates
+//              PL_GetSlowInfo256 reports
+//      tick - timestamp resolution in microseconds, a divisor of 1000000, or 0
+//             for PL_GetTimeStampTick
+// Returns:
+//      1 if successful, 0 otherwise
+// Effect:
+//      Replaces a store of the same name left by a process that has exited,
+//          fails if its filler is still running.  A process has at most one
+//          store open, created or opened.  With freqs NULL or tick 0 the
+//          process must be connected to the server.
+extern "C" int      WINAPI PL_CreateHistoryStore(const char* name, int channels, int seconds,
+                                                 const int* freqs, int tick);
+
+
+// PL_PutHistory - add continuous samples to the history store
+// In:
+//      records - records as read with PL_GetLongWaveFormStructures* or
+//                PL_AcquireBatch; only PL_ADDataType records are stored
+//      n - number of records
+// Returns:
+//      number of samples stored
+// Effect:
+//      Each sample goes to the slot of its timestamp.  Samples missing from
+//          the stream (a gap in the timestamps) read as 0; samples older than
+//          the newest one stored are dropped.  Both are counted in *missing of
+//          PL_GetHistoryRange.  Only the process that created the store may
+//          call it, from one thread at a time.
+extern "C" int      WINAPI PL_PutHistory(const PL_WaveLong* records, int n);
+
+
+// PL_OpenHistoryStore - open a history store created by another process
+// In:
+//      name - shared-memory object name, or NULL for PL_HISTORY_DEFAULT_NAME
+// Returns:
+//      1 if successful, 0 if there is no store
+extern "C" int      WINAPI PL_OpenHistoryStore(const char* name);
+
+
+// PL_GetHistoryRange - time span one channel of the history store covers
+// In:
+//      channel - continuous channel (0 to the store's channels - 1)
+// Out:
+//      *first - timestamp of the oldest sample held, may be NULL
+//      *end - timestamp one sample past the newest, may be NULL
+//      *ticks - timestamp ticks per sample, which need not be a whole number,
+//               may be NULL
+//      *missing - samples stored as 0 because the stream skipped them, and
+//                 samples dropped because their slot was already filled, may be NULL
+// Returns:
+//      1 if the channel has samples, 0 otherwise
+extern "C" int      WINAPI PL_GetHistoryRange(int channel, unsigned long long* first,
+                                              unsigned long long* end, double* ticks,
+                                              unsigned long long* missing);
+
+
+// PL_GetHistory - copy the samples of a time window of one channel
+// In:
+//      channel - continuous channel (0 to the store's channels - 1)
+//      t0, t1 - window [t0, t1) in MAP timestamps
+//      nmax - number of entries in samples
+// Out:
+//      samples - the samples of the window held by the store, oldest first;
+//                at most nmax, the earliest of the window
+//      *first - timestamp of samples[0], may be NULL; sample i was taken at
+//               *first + i * ticks (see PL_GetHistoryRange), to the nearest tick
+// Returns:
+//      number of samples copied
+// Effect:
+//      The window is located from the timestamps alone, without searching.
+//          Never waits for the filler: samples it overwrote while they were
+//          copied are left out, as are those older than the store holds.
+//          Safe to call from any number of threads, in the filler's process too.
+extern "C" int      WINAPI PL_GetHistory(int channel, unsigned long long t0, unsigned long long t1,
+                                         int nmax, short* samples, unsigned long long* first);
+
+
+// PL_CloseHistoryStore - close the history store
+// Effect:
+//      The filler's store is removed; readers that have it open keep their
+//          view of it until they close it.  No PL_GetHistory call may be
+//          running.
+extern "C" void     WINAPI PL_CloseHistoryStore();
+
+
+//
+// Connection options for PL_InitClientEx4
+//
+#define PL_CLIENT_BUSY_POLL     (1)     // PL_WaitForData spins on the ring instead of sleeping
+#define PL_CLIENT_PIN_CPU       (2)     // pin the waiting thread to Cpu
+#define PL_CLIENT_REALTIME      (4)     // run the waiting thread under SCHED_FIFO at Priority
+#define PL_CLIENT_LOCK_MEMORY   (8)     // lock all of the process's memory in RAM (mlockall)
+#define PL_CLIENT_REPLAY        (16)    // start with the records of the last ReplayMillis ms
+
+struct PL_ClientOptions
+{
+    int     Size;           // sizeof(PL_ClientOptions)
+    int     Flags;          // PL_CLIENT_*
+    int     Cpu;            // core for PL_CLIENT_PIN_CPU
+    int     Priority;       // SCHED_FIFO priority for PL_CLIENT_REALTIME (1 to 99), 0 for 50
+    int     ReplayMillis;   // history replayed with PL_CLIENT_REPLAY, 0 for all the server holds
+};
+
+
+// PL_InitClientEx4 - connect to the server with connection options
+// In:
+//      type - client type, as for PL_InitClientEx3
+//      options - connection options, or NULL for the PL_InitClientEx3 behaviour
+// Returns:
+//      1 if connected, 0 otherwise (no server, or options->Size too small)
+// Effect:
+//      PL_CLIENT_LOCK_MEMORY is applied at once.  Pinning and real-time
+//          scheduling are applied to the first thread that waits in
+//          PL_WaitForData (with a nonzero wait), which is the thread that
+//          should then read; the dispatch thread of PL_StartDispatch, for
+//          instance.  With PL_CLIENT_BUSY_POLL, PL_WaitForData never sleeps:
+//          it polls the server's write index, which takes the futex wakeup
+//          out of the latency at the cost of one core kept 100% busy.
+//      Options that the system refuses (e.g. SCHED_FIFO without the
+//          CAP_SYS_NICE capability) are reported on stderr and left out; see
+//          PL_SpinStats::Applied.
+//      With PL_CLIENT_REPLAY the client does not start with the next record
+//          published but with the records published in the last ReplayMillis
+//          ms, as far as the server still holds them, so that it can warm up
+//          in one bulk read.  Reads return either only replayed records or
+//          only new ones: see PL_GetReplayPending and PL_Batch::Replayed.
+extern "C" int      WINAPI PL_InitClientEx4(int type, const PL_ClientOptions* options);
+
+
+
+//
+// Time spent waiting in PL_WaitForData compared with the time between waits
+//
+struct PL_SpinStats
+{
+    unsigned long long  WaitNanos;      // inside PL_WaitForData (spinning, with PL_CLIENT_BUSY_POLL)
+    unsigned long long  WorkNanos;      // between one PL_WaitForData call and the next
+    unsigned long long  Waits;          // PL_WaitForData calls
+    unsigned long long  Polls;          // checks of the write index while waiting
+    int                 Applied;        // PL_CLIENT_* options in effect
+};
+
+
+// PL_GetSpinStats - waiting and working time of this client
+// Out:
+//      stats - times since the connection or the last PL_ResetSpinStats
+// Returns:
+//      1 if connected, 0 otherwise
+extern "C" int      WINAPI PL_GetSpinStats(PL_SpinStats* stats);
+
+
+// PL_ResetSpinStats - restart the waiting and working times from zero
+extern "C" void     WINAPI PL_ResetSpinStats();
+
+
+//
+// Sequence numbers.  Every record the server publishes gets the next 64-bit
+// sequence number of its session (one run of PL_ServerCreate), starting at 0;
+// records are never renumbered, so a client can tell exactly which records
+// it missed and where to resume after reconnecting.  Each lane (see
+// PL_SelectLanes) numbers its records separately; the numbers of the
+// continuous lane have PL_SEQUENCE_CONTINUOUS set.
+//
+#define PL_SEQUENCE_MAX_GAPS    (64)    // gaps kept for PL_GetSequenceGaps
+#define PL_SEQUENCE_CONTINUOUS  (1ull << 63)    // set in the sequence numbers of the continuous lane
+
+struct PL_StreamPosition
+{
+    unsigned long long  Session;        // identifies the server session
+    unsigned long long  Sequence;       // sequence number of the next record to read
+    unsigned long long  ContinuousSequence; // same for the continuous lane
+};
+
+struct PL_SequenceGap
+{
+    unsigned long long  First;          // sequence number of the first missed record
+    unsigned long long  Count;          // number of records missed
+};
+
+
+// PL_GetStreamPosition - where this client is in the server's stream
+// Out:
+//      position - session and next sequence number; keep it to resume with
+//                 PL_ResumeClient after a disconnect
+// Returns:
+//      1 if connected, 0 otherwise
+extern "C" int      WINAPI PL_GetStreamPosition(PL_StreamPosition* position);
+
+
+// PL_GetLongWaveFormStructuresSeq - PL_GetLongWaveFormStructuresEx2 with sequence numbers
+// Out:
+//      sequences - sequence number of each record returned, may be NULL
+//      (other arguments as for PL_GetLongWaveFormStructuresEx2)
+// Effect:
+//      Records skipped by the subscription filter also leave holes in the
+//          sequence numbers; records overwritten before they could be read are
+//          reported by PL_GetSequenceGaps.
+extern "C" void     WINAPI PL_GetLongWaveFormStructuresSeq(int* pnmax, PL_WaveLong* waves,
+                                                           unsigned long long* sequences,
+                                                           int* serverdropped, int* mmfdropped,
+                                                           int* pollhigh, int* polllow);
+
+
+// PL_GetSequenceGaps - ranges of records this client lost
+// In:
+//      nmax - number of entries in gaps
+// Out:
+//      gaps - the ranges of records that were overwritten before this client
+//             read them (mmfdropped), oldest first
+// Returns:
+//      number of gaps copied, at most nmax; those that did not fit are
+//          returned by the next call.  Only the last PL_SEQUENCE_MAX_GAPS gaps
+//          not yet returned are kept.
+extern "C" int      WINAPI PL_GetSequenceGaps(PL_SequenceGap* gaps, int nmax);
+
+
+// PL_ResumeClient - connect and continue from an earlier stream position
+#define PL_RESUME_EXACT         (1)     // reading continues at from->Sequence
+#define PL_RESUME_PARTIAL       (2)     // some records from from->Sequence on are gone
+#define PL_RESUME_NEW_SESSION   (3)     // the server has restarted; reading starts with new data
+// In:
+//      type, options - as for PL_InitClientEx4
+//      from - position saved with PL_GetStreamPosition
+// Returns:
+//      PL_RESUME_*, or 0 if the client could not connect
+// Effect:
+//      With PL_RESUME_PARTIAL the next read reports the lost records as
+//          mmfdropped and through PL_GetSequenceGaps, then continues with the
+//          oldest record the server still holds.  If the client is already
+//          connected, only its read position is moved.  Unless the result is
+//          PL_RESUME_NEW_SESSION, PL_CLIENT_REPLAY has no effect.
+extern "C" int      WINAPI PL_ResumeClient(int type, const PL_ClientOptions* options,
+                                           const PL_StreamPosition* from);
+
+
+// PL_GetReplayPending - replayed records not read yet
+// Returns:
+//      number of records left of the replay requested with PL_CLIENT_REPLAY;
+//          while it is above 0 the next read returns only replayed records,
+//          and once it is 0 no read returns any.  0 if not connected.
+extern "C" int      WINAPI PL_GetReplayPending();
+
+
+// PL_GetReplayEnd - where the replay ends
+// Out:
+//      end - position of the first record that was not replayed; records with
+//            lower sequence numbers (see PL_GetLongWaveFormStructuresSeq) were
+// Returns:
+//      1 if the client connected with PL_CLIENT_REPLAY, 0 otherwise
+extern "C" int      WINAPI PL_GetReplayEnd(PL_StreamPosition* end);
+
+
+//
+// Lanes.  A server created with PL_ServerCreateEx keeps continuous data in a
+// ring of its own, so that bursts of it do not delay or overwrite spikes and
+// events.  Clients read the lanes merged in timestamp order by default.
+//
+#define PL_LANE_EVENTS          (1)     // spikes and events
+#define PL_LANE_CONTINUOUS      (2)     // continuous (PL_ADDataType) records
+#define PL_LANE_ALL             (PL_LANE_EVENTS | PL_LANE_CONTINUOUS)
+
+
+// PL_SelectLanes - choose the lanes this client reads
+// In:
+//      lanes - PL_LANE_* flags, at least one lane; other bits are ignored
+// Returns:
+//      the lanes the server has: PL_LANE_ALL, or PL_LANE_EVENTS if all
+//          records share one lane (lanes then has no effect); 0 if not
+//          connected or lanes selects no lane, leaving the selection as it was
+// Effect:
+//      Records of a lane that is not selected are skipped without counting as
+//          dropped, and PL_WaitForData only waits for the selected lanes, so
+//          a client of PL_LANE_EVENTS is not woken by continuous data at all.
+//          PL_AcquireBatch returns records of one lane at a time; with both
+//          lanes selected, successive batches are in timestamp order.
+extern "C" int      WINAPI PL_SelectLanes(int lanes);
+
+
+#endif